@@ -0,0 +1,201 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Headless batch simulation of a Minsky model, without Tk or the TCL
+// event loop. Integration is performed on the main thread, or, for
+// parameter sweeps, on a pool of worker threads.
+
+#include "minsky.h"
+#include "parameterSweep.h"
+#include <ecolab_epilogue.h>
+
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <limits>
+
+using namespace minsky;
+using namespace std;
+namespace po=boost::program_options;
+
+namespace minsky
+{
+  Minsky& globalMinsky()
+  {
+    static Minsky s_minsky;
+    return s_minsky;
+  }
+
+  // no GUI events to process
+  void doOneEvent() {}
+}
+
+namespace
+{
+  // unqualified names refer to global variables
+  string qualify(const string& name)
+  {
+    return name.find(':')==string::npos? ":"+name: name;
+  }
+
+  /// parse a parameter specification of the form name=a:b for
+  /// random parameters, or name=a:b:n for ranges
+  SweepParameter parseParameter(const string& spec, SweepParameter::Distribution d)
+  {
+    auto eq=spec.find('=');
+    SweepParameter p;
+    p.distribution=d;
+    char sep1=0, sep2=':';
+    if (eq!=string::npos)
+      {
+        p.valueId=qualify(spec.substr(0,eq));
+        istringstream is(spec.substr(eq+1));
+        is>>p.a>>sep1>>p.b;
+        if (d==SweepParameter::range)
+          is>>sep2>>p.n;
+        if (is && sep1==':' && sep2==':')
+          return p;
+      }
+    throw runtime_error("invalid parameter specification "+spec);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  po::options_description desc("usage: minsky-batch [options] model.mky\nOptions");
+  desc.add_options()
+    ("help,h", "print this help message")
+    ("steps,n", po::value<long>()->default_value(-1),
+     "number of simulation steps (each of nSteps integration steps)")
+    ("time,t", po::value<double>(), "run until simulation time reaches this value")
+    ("output,o", po::value<string>()->default_value("minsky.mlog"),
+     "file to write logged variables to, as CSV unless it has the extension .mlog, or sweep results as CSV. Convert .mlog logs to CSV with minsky-log2csv")
+    ("var,v", po::value<vector<string>>(),
+     "variable to log. May be repeated. Default is all variables")
+    ("range", po::value<vector<string>>(),
+     "sweep parameter over n evenly spaced values: name=min:max:n. May be repeated")
+    ("uniform", po::value<vector<string>>(),
+     "sweep parameter uniformly distributed: name=min:max. May be repeated")
+    ("normal", po::value<vector<string>>(),
+     "sweep parameter normally distributed: name=mean:stddev. May be repeated")
+    ("samples", po::value<unsigned>()->default_value(1),
+     "number of sweep runs for each combination of range parameters")
+    ("seed", po::value<unsigned long>()->default_value(0), "random number seed for sweeps")
+    ("threads", po::value<unsigned>()->default_value(0),
+     "number of threads used for sweeps. Default is number of cores")
+    ("model", po::value<string>(), "model file");
+  po::positional_options_description pos;
+  pos.add("model", 1);
+
+  po::variables_map vm;
+  try
+    {
+      po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+      po::notify(vm);
+    }
+  catch (const std::exception& ex)
+    {
+      cerr << ex.what() << endl << desc << endl;
+      return 1;
+    }
+
+  if (vm.count("help") || !vm.count("model") ||
+      (vm["steps"].as<long>()<0 && !vm.count("time")))
+    {
+      cout << desc << endl;
+      return vm.count("help")? 0: 1;
+    }
+
+  long steps=vm["steps"].as<long>();
+  double tmax=vm.count("time")? vm["time"].as<double>(): numeric_limits<double>::max();
+
+  if (vm.count("range") || vm.count("uniform") || vm.count("normal"))
+    try
+      {
+        // parameter sweep, writing final values of the variables to
+        // a CSV file, one row per run
+        ParameterSweep sweep;
+        for (auto d: {make_pair("range",SweepParameter::range),
+              make_pair("uniform",SweepParameter::uniform),
+              make_pair("normal",SweepParameter::normal)})
+          if (vm.count(d.first))
+            for (auto& spec: vm[d.first].as<vector<string>>())
+              sweep.parameters.push_back(parseParameter(spec, d.second));
+        if (!vm.count("var"))
+          throw runtime_error("parameter sweeps require output variables to be specified with --var");
+        for (auto& v: vm["var"].as<vector<string>>())
+          sweep.outputs.push_back(qualify(v));
+        sweep.samples=vm["samples"].as<unsigned>();
+        sweep.seed=vm["seed"].as<unsigned long>();
+        sweep.nThreads=vm["threads"].as<unsigned>();
+        sweep.steps=steps;
+        sweep.tmax=tmax;
+        sweep.run(vm["model"].as<string>());
+
+        ofstream out(vm["output"].as<string>());
+        sweep.writeCSV(out);
+        for (size_t i=0; i<sweep.results.size(); ++i)
+          if (!sweep.results[i].error.empty())
+            cerr << "run "<<i<<": "<<sweep.results[i].error<<endl;
+        return out? 0: 1;
+      }
+    catch (const std::exception& ex)
+      {
+        cerr << ex.what() << endl;
+        return 1;
+      }
+
+  Minsky& m=minsky();
+  m.threadedStep=false;
+  try
+    {
+      m.load(vm["model"].as<string>());
+      m.reset();
+
+      if (vm.count("var"))
+        for (auto& name: vm["var"].as<vector<string>>())
+          {
+            auto v=qualify(name);
+            if (!m.variableValues.count(v))
+              throw runtime_error("unknown variable "+v);
+            m.logVarList.insert(v);
+          }
+      else
+        for (auto& v: m.variableValues)
+          if (v.first.find("constant:")!=0)
+            m.logVarList.insert(v.first);
+      m.openLogFile(vm["output"].as<string>());
+
+      for (long i=0; (steps<0 || i<steps) && m.t<tmax; ++i)
+        {
+          double t=m.t;
+          m.step();
+          if (!(m.t>t))
+            throw runtime_error("simulation time failed to advance at t="+to_string(t));
+        }
+      m.closeLogFile();
+    }
+  catch (const std::exception& ex)
+    {
+      cerr << ex.what() << endl;
+      return 1;
+    }
+  return 0;
+}
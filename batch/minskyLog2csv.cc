@@ -0,0 +1,58 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Converts a binary variable log, as written by Minsky::openLogFile,
+// into CSV.
+// usage: minsky-log2csv log [csv]. CSV is written to stdout if not specified
+
+#include "variableLog.h"
+#include <fstream>
+#include <iostream>
+using namespace minsky;
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+  if (argc<2 || argc>3)
+    {
+      cerr << "usage: "<<argv[0]<<" log [csv]"<<endl;
+      return 1;
+    }
+  try
+    {
+      ifstream log(argv[1], ios::binary);
+      if (!log)
+        throw runtime_error(string("failed to open ")+argv[1]);
+      if (argc==3)
+        {
+          ofstream csv(argv[2]);
+          logToCSV(log, csv);
+          if (!csv)
+            throw runtime_error(string("failed to write ")+argv[2]);
+        }
+      else
+        logToCSV(log, cout);
+    }
+  catch (const std::exception& ex)
+    {
+      cerr << ex.what() << endl;
+      return 1;
+    }
+  return 0;
+}
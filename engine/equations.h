@@ -34,6 +34,7 @@
 #include <ostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include "integral.h"
 
@@ -255,31 +256,64 @@ namespace MathDAG
     int order(unsigned maxOrder) const override {return 0;} // Godley columns define integration vars
   };
 
+  /// cache of DAG nodes created from model items. Operations and
+  /// switches are identified by their first port, and variables by
+  /// an integer interned from their valueId, so that lookups do not
+  /// construct string keys
   class SubexpressionCache
   {
-    std::map<std::string, NodePtr > cache;
-    std::map<std::string, VariableDAGPtr> integrationInputs;
-    std::map<const Node*, NodePtr> reverseLookupCache;
+    typedef std::unordered_map<const void*, NodePtr> ItemCache;
+    typedef std::unordered_map<int, NodePtr> VarCache;
+    ItemCache itemCache;
+    VarCache varCache;
+    std::unordered_map<std::string, VariableDAGPtr> integrationInputs;
+    std::unordered_map<const Node*, NodePtr> reverseLookupCache;
+    /// interned valueIds, and the valueId of each variable item seen,
+    /// which is computed only on the item's first lookup
+    mutable std::unordered_map<std::string, int> valueIds;
+    mutable std::unordered_map<const VariableBase*, int> variableIds;
+
+    const void* id(const OperationBase& x) const {return x.ports[0].get();}
+    const void* id(const SwitchIcon& x) const {return x.ports[0].get();}
+    int id(const VariableBase& x) const {
+      auto i=variableIds.find(&x);
+      if (i==variableIds.end())
+        i=variableIds.emplace(&x, id(x.valueId())).first;
+      return i->second;
+    }
+    /// strings refer to variable valueIds
+    int id(const std::string& x) const {
+      return valueIds.emplace(x, valueIds.size()).first->second;
+    }
+    ItemCache& table(const void*) {return itemCache;}
+    const ItemCache& table(const void*) const {return itemCache;}
+    VarCache& table(int) {return varCache;}
+    const VarCache& table(int) const {return varCache;}
   public:
+    /// string representation of an entry's key, for diagnostics
     std::string key(const OperationBase& x) const {
-      return "op:"+std::to_string(size_t(x.ports[0].get()));
+      return "op:"+std::to_string(size_t(id(x)));
     }
     std::string key(const VariableBase& x) const {
       return "var:"+x.valueId();
     }
     std::string key(const SwitchIcon& x) const {
-      return "switch:"+std::to_string(size_t(x.ports[0].get()));
+      return "switch:"+std::to_string(size_t(id(x)));
     }
-    /// strings refer to variable names
     std::string key(const string& x) const {
       return "var:"+x;
     }
     template <class T>
-    bool exists(const T& x) {return cache.count(key(x));}
+    bool exists(const T& x) const {
+      const auto& k=id(x);
+      return table(k).count(k);
+    }
     template <class T>
     NodePtr operator[](const T& x) const {
-      auto r=cache.find(key(x));
-      if (r!=cache.end())
+      const auto& k=id(x);
+      auto& t=table(k);
+      auto r=t.find(k);
+      if (r!=t.end())
         return r->second;
       else
         return NodePtr();
@@ -287,20 +321,21 @@ namespace MathDAG
     template <class T>
     const NodePtr& insert(const T& x, const NodePtr& n) {
       reverseLookupCache[n.get()]=n;
-      return cache.insert(make_pair(key(x),n)).first->second;
+      const auto& k=id(x);
+      return table(k).emplace(k,n).first->second;
     }
     void insertIntegralInput(const string& name, const VariableDAGPtr& n) {
-      integrationInputs.insert(make_pair("input:"+name,n));
+      integrationInputs.emplace(name,n);
       reverseLookupCache[n.get()]=n;
     }
     VariableDAGPtr getIntegralInput(const string& name) const {
-      auto r=integrationInputs.find("input:"+name);
+      auto r=integrationInputs.find(name);
       if (r!=integrationInputs.end())
         return r->second;
       else
         return VariableDAGPtr();
     }
-    size_t size() const {return cache.size()+integrationInputs.size();}
+    size_t size() const {return itemCache.size()+varCache.size()+integrationInputs.size();}
     /// returns NodePtr corresponding to object \x, if it exists in cache, nullptr otherwise
     NodePtr reverseLookup(const Node& x) const {
       auto it=reverseLookupCache.find(&x);
@@ -313,7 +348,7 @@ namespace MathDAG
     //NodePtr insertAnonymous(const NodePtr& x) {
     NodePtr insertAnonymous(NodePtr x) {
       assert(x);
-      return reverseLookupCache.insert(make_pair(x.get(), x)).first->second;
+      return reverseLookupCache.emplace(x.get(), x).first->second;
     }
   };
 
@@ -83,12 +83,45 @@ namespace minsky
       }
   }
 
-  void EvalGodley::eval(double sv[], const double fv[]) const
+  void EvalGodley::compress(const vector<unsigned>& s, const vector<unsigned>& f,
+                            const vector<double>& c)
   {
-    for (size_t i=0; i<initIdx.size(); ++i)
-      sv[initIdx[i]]=0;
+    // counting sort the elements by stock, preserving their order
+    // within each stock, so sums are accumulated in the same order
+    // as the tables are read
+    unsigned nStocks=s.empty()? 0: *max_element(s.begin(), s.end())+1;
+    vector<unsigned> count(nStocks+1);
+    for (auto i: s) ++count[i+1];
+
+    stockIdx.clear();
+    rowStart.assign(1,0);
+    vector<unsigned> next(nStocks);
+    for (unsigned i=0; i<nStocks; ++i)
+      if (count[i+1])
+        {
+          next[i]=rowStart.back();
+          stockIdx.push_back(i);
+          rowStart.push_back(rowStart.back()+count[i+1]);
+        }
+
+    flowIdx.resize(s.size());
+    coef.resize(s.size());
+    for (size_t i=0; i<s.size(); ++i)
+      {
+        auto k=next[s[i]]++;
+        flowIdx[k]=f[i];
+        coef[k]=c[i];
+      }
+  }
 
-    for (size_t i=0; i<sidx.size(); ++i)
-      sv[sidx[i]] += fv[fidx[i]] * m[i];
+  void EvalGodley::eval(double sv[], const double fv[]) const
+  {
+    for (size_t r=0; r<stockIdx.size(); ++r)
+      {
+        double s=0;
+        for (size_t k=rowStart[r]; k<rowStart[r+1]; ++k)
+          s+=fv[flowIdx[k]]*coef[k];
+        sv[stockIdx[r]]=s;
+      }
   }
 }
@@ -34,12 +34,18 @@ namespace minsky
 
   class EvalGodley
   {
-    /// representation of matrix connecting flow variables to stock variables
-    ecolab::array<int> sidx, fidx;
-    ecolab::array<double> m;
-
-    /// index of stock variables that need to be zeroed at start of eval
-    ecolab::array<int> initIdx;
+    /// sparse matrix connecting flow variables to stock variables,
+    /// in compressed row form. Row r gives stock variable
+    /// stockIdx[r] as the sum of flowIdx[k]*coef[k], for k in
+    /// [rowStart[r], rowStart[r+1]). Only stocks with a nonzero row
+    /// are represented.
+    std::vector<unsigned> stockIdx, rowStart, flowIdx;
+    std::vector<double> coef;
+
+    /// build compressed row representation from (stock, flow,
+    /// coefficient) triples, in order of appearance
+    void compress(const std::vector<unsigned>& s, const std::vector<unsigned>& f,
+                  const std::vector<double>& c);
 
     CLASSDESC_ACCESS(EvalGodley);
   public:
@@ -56,6 +62,16 @@ namespace minsky
     /// flowVars.
     void eval(double sv[], const double fv[]) const;
 
+    /// calls \a f(stockIdx, flowIdx) for each nonzero element of the
+    /// flow to stock matrix, row by row
+    template <class F> void forAllElements(F f) const {
+      for (size_t r=0; r<stockIdx.size(); ++r)
+        for (size_t k=rowStart[r]; k<rowStart[r+1]; ++k)
+          f(stockIdx[r], flowIdx[k]);
+    }
+    /// number of nonzero elements of the flow to stock matrix
+    size_t nonZeros() const {return coef.size();}
+
     EvalGodley():  compatibility(false) {}
     /// if compatibility is true, then consttrainst between Godley
     /// tables is not applied, and shared columns are merely summed
@@ -120,11 +136,8 @@ namespace minsky
      const VariableValues& values)
   {
     SharedColumnCheck scCheck;
-    sidx.resize(0);
-    fidx.resize(0);
-    m.resize(0);
-
-    std::set<int> iidx;
+    std::vector<unsigned> sidx, fidx;
+    std::vector<double> m;
 
     for (GodleyIterator g=begin; g!=end; ++g)
       {
@@ -153,18 +166,15 @@ namespace minsky
                             scCheck.updateColDefs(svName, fvc))
                           continue;
                 
-                        iidx.insert(sv.idx());
-                        sidx<<=sv.idx();
-                        fidx<<=fv.idx();
-                        m<<=fvc.coef;
+                        sidx.push_back(sv.idx());
+                        fidx.push_back(fv.idx());
+                        m.push_back(fvc.coef);
                       }
                   }
               }
       }
     
-    for (std::set<int>::iterator i=iidx.begin(); i!=iidx.end(); ++i)
-      initIdx<<=*i;
-
+    compress(sidx, fidx, m);
     if (!compatibility)
       scCheck.checkSharedColDefs();
   }
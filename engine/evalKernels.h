@@ -0,0 +1,106 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Elementwise kernels applied to contiguous runs of vector
+  operations. Arguments are either contiguous (stride 1), or a
+  broadcast scalar (stride 0). Arithmetic ops are explicitly
+  vectorised where AVX or SSE2 is available at compile time, with a
+  scalar fallback otherwise.
+*/
+
+#ifndef EVALKERNELS_H
+#define EVALKERNELS_H
+
+#include <algorithm>
+#include <stddef.h>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace minsky
+{
+  namespace kernels
+  {
+#if defined(__AVX__)
+    typedef __m256d Vec;
+    static const size_t width=4;
+    inline Vec load(const double* x, unsigned stride)
+    {return stride? _mm256_loadu_pd(x): _mm256_broadcast_sd(x);}
+    inline void store(double* x, Vec v) {_mm256_storeu_pd(x,v);}
+    inline Vec add(Vec x, Vec y) {return _mm256_add_pd(x,y);}
+    inline Vec subtract(Vec x, Vec y) {return _mm256_sub_pd(x,y);}
+    inline Vec multiply(Vec x, Vec y) {return _mm256_mul_pd(x,y);}
+    inline Vec divide(Vec x, Vec y) {return _mm256_div_pd(x,y);}
+    // operands swapped to reproduce std::min/max's treatment of NaNs
+    inline Vec min(Vec x, Vec y) {return _mm256_min_pd(y,x);}
+    inline Vec max(Vec x, Vec y) {return _mm256_max_pd(y,x);}
+#elif defined(__SSE2__)
+    typedef __m128d Vec;
+    static const size_t width=2;
+    inline Vec load(const double* x, unsigned stride)
+    {return stride? _mm_loadu_pd(x): _mm_set1_pd(*x);}
+    inline void store(double* x, Vec v) {_mm_storeu_pd(x,v);}
+    inline Vec add(Vec x, Vec y) {return _mm_add_pd(x,y);}
+    inline Vec subtract(Vec x, Vec y) {return _mm_sub_pd(x,y);}
+    inline Vec multiply(Vec x, Vec y) {return _mm_mul_pd(x,y);}
+    inline Vec divide(Vec x, Vec y) {return _mm_div_pd(x,y);}
+    inline Vec min(Vec x, Vec y) {return _mm_min_pd(y,x);}
+    inline Vec max(Vec x, Vec y) {return _mm_max_pd(y,x);}
+#else
+    // scalar fallback
+    typedef double Vec;
+    static const size_t width=1;
+    inline Vec load(const double* x, unsigned) {return *x;}
+    inline void store(double* x, Vec v) {*x=v;}
+    inline Vec add(Vec x, Vec y) {return x+y;}
+    inline Vec subtract(Vec x, Vec y) {return x-y;}
+    inline Vec multiply(Vec x, Vec y) {return x*y;}
+    inline Vec divide(Vec x, Vec y) {return x/y;}
+    inline Vec min(Vec x, Vec y) {return std::min(x,y);}
+    inline Vec max(Vec x, Vec y) {return std::max(x,y);}
+#endif
+
+    /// r[i]=f(a[i*sa],b[i*sb]) for i<n, with \a v the vectorised
+    /// form of \a f
+    template <class V, class F>
+    void binary(double* r, const double* a, unsigned sa,
+                const double* b, unsigned sb, size_t n, V v, F f)
+    {
+      size_t i=0;
+      for (; i+width<=n; i+=width)
+        store(r+i, v(load(a+i*sa,sa), load(b+i*sb,sb)));
+      for (; i<n; ++i)
+        r[i]=f(a[i*sa], b[i*sb]);
+    }
+
+    /// r[i]=f(a[i*sa]) for i<n
+    template <class F>
+    void unary(double* r, const double* a, unsigned sa, size_t n, F f)
+    {
+      if (sa)
+        for (size_t i=0; i<n; ++i) r[i]=f(a[i]);
+      else
+        std::fill(r, r+n, f(*a));
+    }
+  }
+}
+
+#endif
@@ -119,8 +119,8 @@ namespace minsky
   double EvalOp<OperationType::constant>::d2(double x1, double x2) const
   {return 0;}
 
-  double EvalOpBase::t;
-  string EvalOpBase::timeUnit;
+  thread_local double EvalOpBase::t;
+  thread_local string EvalOpBase::timeUnit;
 
   template <>
   double EvalOp<OperationType::time>::evaluate(double in1, double in2) const
@@ -164,6 +164,10 @@ namespace minsky
   double EvalOp<OperationType::differentiate>::d2(double x1, double x2) const
   {return 0;}
 
+  double DataEvalOp::evaluate(double in1, double in2) const
+  {return state? dynamic_cast<DataOp&>(*state).data.interpolate(in1, cursor): 0;}
+  double DataEvalOp::d1(double x1, double x2) const
+  {return state? dynamic_cast<DataOp&>(*state).data.deriv(x1, cursor): 0;}
   template <> double 
   EvalOp<OperationType::data>::evaluate(double in1, double in2) const
   {return state? dynamic_cast<DataOp&>(*state).interpolate(in1): 0;}
@@ -483,6 +487,8 @@ namespace minsky
       {
       case constant:
         return new ConstantEvalOp;
+      case data:
+        return new DataEvalOp;
       case numOps:
         return NULL;
       default:
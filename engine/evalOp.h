@@ -51,9 +51,13 @@ namespace minsky
   {
     typedef OperationType::Type Type;
 
-    // value used for the time operator
-    static double t;
-    static std::string timeUnit;
+    /// value used for the time operator. Thread local, as is the
+    /// rest of the simulation state, so that models can be simulated
+    /// concurrently on separate threads
+    static thread_local double t;
+    /// units of the time operator, set from the Minsky whose
+    /// equations are being constructed on this thread
+    static thread_local std::string timeUnit;
 
     /// indexes into the flow/stock variables vector
     int out=-1;//, outX=-1, inX=-1;
@@ -122,6 +126,15 @@ namespace minsky
     double evaluate(double in1=0, double in2=0) const override;
    };
 
+  /// data lookups start where this op's previous lookup ended, as
+  /// successive arguments are usually close together
+  struct DataEvalOp: public EvalOp<minsky::OperationType::data>
+  {
+    mutable DataSeries::Cursor cursor;
+    double evaluate(double in1=0, double in2=0) const override;
+    double d1(double x1=0, double x2=0) const override;
+  };
+
   struct EvalOpPtr: public classdesc::shared_ptr<EvalOpBase>, 
                     public OperationType
   {
@@ -0,0 +1,226 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cairoItems.h"
+#include "evalProgram.h"
+#include "evalKernels.h"
+#include "minsky.h"
+
+#include <ecolab_epilogue.h>
+
+#include <math.h>
+
+namespace minsky
+{
+  namespace
+  {
+    /// true if evaluating a run of \a count elements in one pass may
+    /// read an input element after it has been overwritten
+    bool hazard(unsigned out, unsigned count, bool flow, unsigned in, unsigned stride)
+    {
+      if (!flow) return false; // stock variables are never written
+      if (stride==1 && in==out) return false; // elementwise in place
+      unsigned inEnd=in+(stride? count: 1);
+      return in<out+count && out<inEnd;
+    }
+
+    inline double evalScalar(const EvalInstruction& i, double x1, double x2)
+    {
+      switch (i.op)
+        {
+        case OperationType::constant: return i.value;
+        case OperationType::time: return EvalOpBase::t;
+        case OperationType::copy: return x1;
+        case OperationType::add: return x1+x2;
+        case OperationType::subtract: return x1-x2;
+        case OperationType::multiply: return x1*x2;
+        case OperationType::divide: return x1/x2;
+        case OperationType::log: return ::log(x1)/::log(x2);
+        case OperationType::pow: return ::pow(x1,x2);
+        case OperationType::lt: return x1<x2;
+        case OperationType::le: return x1<=x2;
+        case OperationType::eq: return x1==x2;
+        case OperationType::min: return std::min(x1,x2);
+        case OperationType::max: return std::max(x1,x2);
+        case OperationType::and_: return x1>0.5 && x2>0.5;
+        case OperationType::or_: return x1>0.5 || x2>0.5;
+        case OperationType::not_: return x1<=0.5;
+        case OperationType::sqrt: return ::sqrt(x1);
+        case OperationType::exp: return ::exp(x1);
+        case OperationType::ln: return ::log(x1);
+        case OperationType::sin: return ::sin(x1);
+        case OperationType::cos: return ::cos(x1);
+        case OperationType::tan: return ::tan(x1);
+        case OperationType::asin: return ::asin(x1);
+        case OperationType::acos: return ::acos(x1);
+        case OperationType::atan: return ::atan(x1);
+        case OperationType::sinh: return ::sinh(x1);
+        case OperationType::cosh: return ::cosh(x1);
+        case OperationType::tanh: return ::tanh(x1);
+        case OperationType::abs: return ::fabs(x1);
+        case OperationType::floor: return ::floor(x1);
+        case OperationType::frac: return x1-::floor(x1);
+        default:
+          // operations carrying state, such as data
+          return i.evalOp->evaluate(x1,x2);
+        }
+    }
+  }
+
+  void EvalProgram::compile(const EvalOpVector& equations)
+  {
+    code.clear();
+    for (auto& e: equations)
+      {
+        EvalInstruction instr;
+        instr.op=e->type();
+        instr.evalOp=e.get();
+        assert(e->out>=0);
+        if (auto c=dynamic_cast<ConstantEvalOp*>(e.get()))
+          instr.value=c->value;
+        // unused arguments are pointed at flowVars[0]
+        instr.flow1=e->numArgs()<1 || e->flow1;
+        instr.flow2=e->numArgs()<2 || e->flow2;
+        switch (e->numArgs())
+          {
+          case 0:
+            instr.out=e->out;
+            code.push_back(instr);
+            break;
+          case 1: case 2:
+            {
+              // split vector operations into maximal runs where each
+              // input index is either constant or incrementing by one
+              bool binary=e->numArgs()>1;
+              size_t n=e->in1.size();
+              for (size_t i=0, j; i<n; i=j)
+                {
+                  instr.out=e->out+i;
+                  instr.in1=e->in1[i];
+                  instr.in2=binary? e->in2[i]: 0;
+                  instr.stride1=instr.stride2=0;
+                  j=i+1;
+                  if (j<n)
+                    {
+                      long s1=long(e->in1[j])-e->in1[i];
+                      long s2=binary? long(e->in2[j])-e->in2[i]: 0;
+                      if ((s1==0 || s1==1) && (s2==0 || s2==1))
+                        {
+                          for (; j<n && e->in1[j]==e->in1[i]+(j-i)*s1 &&
+                                 (!binary || e->in2[j]==e->in2[i]+(j-i)*s2); ++j);
+                          instr.stride1=s1;
+                          instr.stride2=s2;
+                        }
+                    }
+                  instr.count=j-i;
+                  if (instr.count>1 &&
+                      (hazard(instr.out, instr.count, instr.flow1, instr.in1, instr.stride1) ||
+                       (binary && hazard(instr.out, instr.count, instr.flow2, instr.in2, instr.stride2))))
+                    {
+                      instr.count=1;
+                      j=i+1;
+                    }
+                  if (instr.count==1)
+                    instr.stride1=instr.stride2=0;
+                  code.push_back(instr);
+                }
+              break;
+            }
+          }
+      }
+  }
+
+  void EvalProgram::nonFinite(const EvalInstruction& instr, unsigned i,
+                              const double fv[], const double sv[]) const
+  {
+    auto& e=*instr.evalOp;
+    if (e.state)
+      minsky().displayErrorItem(*e.state);
+    unsigned in1=instr.in1+i*instr.stride1, in2=instr.in2+i*instr.stride2;
+    string msg="Invalid: "+OperationBase::typeName(instr.op)+"(";
+    if (e.numArgs()>0)
+      msg+=to_string(instr.flow1? fv[in1]: sv[in1]);
+    if (e.numArgs()>1)
+      msg+=","+to_string(instr.flow2? fv[in2]: sv[in2]);
+    msg+=")";
+    throw error(msg.c_str());
+  }
+
+#define BINARY_KERNEL(op, expr)                                         \
+  case OperationType::op:                                               \
+    kernels::binary(r, a, i.stride1, b, i.stride2, i.count,             \
+                    [](kernels::Vec x1, kernels::Vec x2) {return kernels::op(x1,x2);}, \
+                    [](double x1, double x2) {return expr;});           \
+    break;
+#define UNARY_KERNEL(op, expr)                                          \
+  case OperationType::op:                                               \
+    kernels::unary(r, a, i.stride1, i.count, [](double x1) {return expr;}); \
+    break;
+
+  void EvalProgram::evalVector(const EvalInstruction& i, double fv[], const double sv[]) const
+  {
+    double* r=fv+i.out;
+    const double* a=(i.flow1? fv: sv)+i.in1;
+    const double* b=(i.flow2? fv: sv)+i.in2;
+    switch (i.op)
+      {
+        BINARY_KERNEL(add, x1+x2);
+        BINARY_KERNEL(subtract, x1-x2);
+        BINARY_KERNEL(multiply, x1*x2);
+        BINARY_KERNEL(divide, x1/x2);
+        BINARY_KERNEL(min, std::min(x1,x2));
+        BINARY_KERNEL(max, std::max(x1,x2));
+        UNARY_KERNEL(copy, x1);
+        UNARY_KERNEL(sqrt, ::sqrt(x1));
+        UNARY_KERNEL(exp, ::exp(x1));
+        UNARY_KERNEL(ln, ::log(x1));
+        UNARY_KERNEL(sin, ::sin(x1));
+        UNARY_KERNEL(cos, ::cos(x1));
+        UNARY_KERNEL(tan, ::tan(x1));
+        UNARY_KERNEL(abs, ::fabs(x1));
+        UNARY_KERNEL(floor, ::floor(x1));
+      default:
+        for (unsigned k=0; k<i.count; ++k)
+          r[k]=evalScalar(i, a[k*i.stride1], b[k*i.stride2]);
+        break;
+      }
+    for (unsigned k=0; k<i.count; ++k)
+      if (!isfinite(r[k]))
+        nonFinite(i,k,fv,sv);
+  }
+
+#undef BINARY_KERNEL
+#undef UNARY_KERNEL
+
+  void EvalProgram::eval(double fv[], const double sv[]) const
+  {
+    for (auto& i: code)
+      if (i.count>1)
+        evalVector(i,fv,sv);
+      else
+        {
+          // arguments are fetched unconditionally. For operations with
+          // fewer arguments, in1/in2 default to 0, which is always a
+          // valid flowVar index
+          double& r=fv[i.out];
+          r=evalScalar(i, i.flow1? fv[i.in1]: sv[i.in1], i.flow2? fv[i.in2]: sv[i.in2]);
+          if (!isfinite(r))
+            nonFinite(i,0,fv,sv);
+        }
+  }
+}
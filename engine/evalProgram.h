@@ -0,0 +1,81 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef EVALPROGRAM_H
+#define EVALPROGRAM_H
+
+#include "evalOp.h"
+#include <vector>
+
+namespace minsky
+{
+  /// a single instruction of a compiled EvalOpVector, applied to \a
+  /// count consecutive output elements
+  struct EvalInstruction
+  {
+    OperationType::Type op;
+    /// indexes into the flow/stock variables vector
+    unsigned out, in1=0, in2=0;
+    /// number of elements, and the stride (0 or 1) in which the input
+    /// indices advance with each element
+    unsigned count=1, stride1=0, stride2=0;
+    /// indicate whether in1/in2 are flow variables
+    bool flow1=true, flow2=true;
+    /// value of constant operations
+    double value=0;
+    /// EvalOp this instruction was compiled from. Used for
+    /// operations carrying state (eg data), and for error diagnostics
+    EvalOpBase* evalOp=nullptr;
+  };
+
+  /**
+     A flattened representation of an EvalOpVector, consisting of a
+     contiguous stream of instructions that is interpreted by a
+     single switch statement, rather than virtual dispatch through
+     each EvalOpPtr for every element. Runs of vector elements with
+     contiguous or broadcast indices are coalesced into a single
+     instruction, and evaluated with the kernels in evalKernels.h
+  */
+  class EvalProgram
+  {
+    std::vector<EvalInstruction> code;
+    /// throws the diagnostic for a nonfinite result of element \a i
+    /// of \a instr
+    [[noreturn]] void nonFinite(const EvalInstruction& instr, unsigned i,
+                                const double fv[], const double sv[]) const;
+    /// evaluate a coalesced run of elements
+    void evalVector(const EvalInstruction&, double fv[], const double sv[]) const;
+  public:
+    /// compile \a equations into this program. \a equations must
+    /// outlive this program.
+    void compile(const EvalOpVector& equations);
+    void clear() {code.clear();}
+    size_t size() const {return code.size();}
+    bool empty() const {return code.empty();}
+    const std::vector<EvalInstruction>& instructions() const {return code;}
+
+    /// evaluate program on sv and current value of fv, storing results
+    /// in fv. Equivalent to calling eval() on each element of the
+    /// compiled EvalOpVector in turn.
+    /// @throw ecolab::error if a nonfinite value is produced
+    void eval(double fv[], const double sv[]) const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "variableLog.h"
+
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+using namespace std;
+
+namespace minsky
+{
+  namespace
+  {
+    const char magic[]="MINSKYL1";
+    const size_t magicLen=sizeof(magic)-1;
+    const size_t maxPending=4;
+
+    void writeString(ostream& o, const string& x)
+    {
+      uint32_t len=x.length();
+      o.write(reinterpret_cast<const char*>(&len), sizeof(len));
+      o.write(x.data(), len);
+    }
+
+    template <class T> bool readPOD(istream& i, T& x)
+    {
+      i.read(reinterpret_cast<char*>(&x), sizeof(x));
+      return bool(i);
+    }
+
+    string readString(istream& i)
+    {
+      uint32_t len;
+      if (!readPOD(i,len))
+        throw runtime_error("truncated log header");
+      string r(len,'\0');
+      i.read(&r[0], len);
+      return r;
+    }
+  }
+
+  VariableLog::VariableLog(const string& filename, const vector<Column>& columns,
+                           bool backgroundWriter, size_t blockRows):
+    out(filename, ios::binary), nColumns(columns.size()), blockRows(max(blockRows,size_t(1))),
+    block(nColumns*this->blockRows), column(this->blockRows)
+  {
+    if (!out)
+      throw runtime_error("failed to open "+filename);
+    out.write(magic, magicLen);
+    uint32_t n=nColumns;
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    for (auto& c: columns)
+      {
+        writeString(out, c.name);
+        writeString(out, c.units);
+      }
+    if (backgroundWriter)
+      writer=thread([this](){writerLoop();});
+  }
+
+  VariableLog::~VariableLog()
+  {
+    try {flush();}
+    catch (...) {} // write errors have already been reported, if possible
+    if (writer.joinable())
+      {
+        {
+          lock_guard<mutex> lock(m);
+          finished=true;
+        }
+        cv.notify_all();
+        writer.join();
+      }
+  }
+
+  void VariableLog::submitBlock()
+  {
+    if (!writer.joinable())
+      {
+        writeBlock(block, rows);
+        if (!out)
+          throw runtime_error("failed to write log file");
+      }
+    else
+      {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this](){return pending.size()<maxPending;});
+        if (failed)
+          throw runtime_error("failed to write log file");
+        pending.emplace_back(move(block), rows);
+        if (spare.empty())
+          block.resize(nColumns*blockRows);
+        else
+          {
+            block.swap(spare.back());
+            spare.pop_back();
+          }
+        cv.notify_all();
+      }
+    rows=0;
+  }
+
+  void VariableLog::flush()
+  {
+    if (rows) submitBlock();
+    if (writer.joinable())
+      {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this](){return pending.empty() && !writing;});
+      }
+    out.flush();
+    if (!out)
+      throw runtime_error("failed to write log file");
+  }
+
+  void VariableLog::writeBlock(const vector<double>& b, size_t n)
+  {
+    uint32_t n32=n;
+    out.write(reinterpret_cast<const char*>(&n32), sizeof(n32));
+    // transpose into columns
+    for (size_t c=0; c<nColumns; ++c)
+      {
+        for (size_t r=0; r<n; ++r)
+          column[r]=b[r*nColumns+c];
+        out.write(reinterpret_cast<const char*>(&column[0]), n*sizeof(double));
+      }
+  }
+
+  void VariableLog::writerLoop()
+  {
+    unique_lock<mutex> lock(m);
+    for (;;)
+      {
+        cv.wait(lock, [this](){return !pending.empty() || finished;});
+        if (pending.empty()) return;
+        auto b=move(pending.front());
+        pending.pop_front();
+        writing=true;
+        lock.unlock();
+        // once a write has failed, discard the remaining blocks. The
+        // failure is reported on the next submitBlock() or flush()
+        if (!failed)
+          writeBlock(b.first, b.second);
+        lock.lock();
+        if (!out) failed=true;
+        spare.push_back(move(b.first));
+        writing=false;
+        cv.notify_all();
+      }
+  }
+
+  void logToCSV(istream& log, ostream& csv)
+  {
+    char m[magicLen];
+    log.read(m, magicLen);
+    if (!log || strncmp(m, magic, magicLen)!=0)
+      throw runtime_error("not a Minsky log file");
+    uint32_t nColumns;
+    if (!readPOD(log, nColumns))
+      throw runtime_error("truncated log header");
+
+    for (size_t c=0; c<nColumns; ++c)
+      {
+        auto name=readString(log), units=readString(log);
+        if (c) csv<<",";
+        csv<<name;
+        if (!units.empty())
+          csv<<" ("<<units<<")";
+      }
+    csv<<"\n";
+
+    csv<<setprecision(numeric_limits<double>::max_digits10);
+    vector<double> block;
+    uint32_t rows;
+    while (readPOD(log, rows))
+      {
+        block.resize(size_t(rows)*nColumns);
+        log.read(reinterpret_cast<char*>(block.data()), block.size()*sizeof(double));
+        if (!log)
+          throw runtime_error("truncated log block");
+        for (size_t r=0; r<rows; ++r)
+          {
+            for (size_t c=0; c<nColumns; ++c)
+              {
+                if (c) csv<<",";
+                csv<<block[c*rows+r];
+              }
+            csv<<"\n";
+          }
+      }
+  }
+}
@@ -0,0 +1,112 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  Binary log of simulation variables. The file consists of
+
+    magic number "MINSKYL1"
+    uint32 number of columns, followed for each column by its name
+    and units, each a uint32 length followed by the characters
+
+  followed by a sequence of blocks, each consisting of a uint32 row
+  count n, followed by n doubles for each column in turn. All
+  quantities are in native byte order.
+*/
+
+#ifndef VARIABLELOG_H
+#define VARIABLELOG_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace minsky
+{
+  class VariableLog
+  {
+  public:
+    struct Column
+    {
+      std::string name, units;
+      Column(const std::string& name="", const std::string& units=""):
+        name(name), units(units) {}
+    };
+
+    /// open \a filename, and write the header describing \a
+    /// columns. If \a backgroundWriter, completed blocks are written
+    /// to disk on a separate thread.
+    /// @throw std::runtime_error if file cannot be opened
+    VariableLog(const std::string& filename, const std::vector<Column>& columns,
+                bool backgroundWriter=true, size_t blockRows=1024);
+    /// flushes outstanding rows
+    ~VariableLog();
+
+    size_t numColumns() const {return nColumns;}
+    /// returns storage for the next row, to be filled in with
+    /// numColumns() values before the next call
+    /// @throw std::runtime_error if writing a previous block failed
+    double* nextRow() {
+      if (rows==blockRows) submitBlock();
+      return &block[nColumns*rows++];
+    }
+    /// write all rows logged so far to disk
+    /// @throw std::runtime_error if writing the file failed
+    void flush();
+
+  private:
+    std::ofstream out;
+    size_t nColumns, blockRows, rows=0;
+    /// block currently being filled, in row major order
+    std::vector<double> block;
+
+    // background writer state
+    std::thread writer;
+    std::mutex m;
+    std::condition_variable cv;
+    /// blocks awaiting writing, and their row counts. At most
+    /// maxPending are queued before the simulation waits for the writer
+    std::deque<std::pair<std::vector<double>,size_t>> pending;
+    /// emptied buffers available for reuse
+    std::vector<std::vector<double>> spare;
+    bool writing=false, finished=false;
+    /// set by the writer thread when writing to the file fails
+    bool failed=false;
+    /// scratch space for transposing a block
+    std::vector<double> column;
+
+    void submitBlock();
+    void writeBlock(const std::vector<double>&, size_t rows);
+    void writerLoop();
+
+    VariableLog(const VariableLog&)=delete;
+    void operator=(const VariableLog&)=delete;
+  };
+
+  /// convert binary log \a log into comma separated values, one row
+  /// per logged time step
+  /// @throw std::runtime_error if \a log is not a valid log file
+  void logToCSV(std::istream& log, std::ostream& csv);
+}
+
+#endif
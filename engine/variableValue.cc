@@ -27,8 +27,8 @@ using namespace ecolab;
 using namespace std;
 namespace minsky
 {
-  std::vector<double> ValueVector::stockVars(1);
-  std::vector<double> ValueVector::flowVars(1);
+  thread_local std::vector<double> ValueVector::stockVars(1);
+  thread_local std::vector<double> ValueVector::flowVars(1);
 
   VariableValue& VariableValue::allocValue()
   {
@@ -162,15 +162,17 @@ namespace minsky
     static std::string uqName(const std::string& name);
   };
 
+  /// Variable values are stored per thread, so that distinct Minsky
+  /// instances may be simulated concurrently, each on its own thread
   struct ValueVector
   {
     /// vector of variables that are integrated via Runge-Kutta. These
     /// variables label the columns of the Godley table
-    static std::vector<double> stockVars;
+    static thread_local std::vector<double> stockVars;
     /// variables defined as a simple function of the stock variables,
     /// also known as lhs variables. These variables appear in the body
     /// of the Godley table
-    static std::vector<double> flowVars;
+    static thread_local std::vector<double> flowVars;
   };
 
   struct VariableValues: public ConstMap<std::string, VariableValue>
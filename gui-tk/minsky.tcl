@@ -599,7 +599,8 @@ proc logVarsOK {} {
     foreach i $indices {lappend vars [lindex $varIds $i]}
     logVarList $vars
     destroy .logVars
-    openLogFile [tk_getSaveFile -defaultextension .dat -initialdir $workDir]
+    openLogFile [tk_getSaveFile -defaultextension .csv -initialdir $workDir \
+                     -filetypes {{"CSV files" .csv TEXT} {"Minsky binary log" .mlog}}]
 }
 
 
@@ -725,7 +726,27 @@ label .wiring.panopticon -image panopticon -width 100 -height 100 -borderwidth 3
 #place .wiring.panopticon -relx 1 -rely 0 -anchor ne
 minsky.panopticon.width $canvasWidth
 minsky.panopticon.height $canvasHeight
-bind .wiring.canvas <Configure> {setScrollBars; minsky.panopticon.width %w; minsky.panopticon.height %h; panopticon.requestRedraw}
+bind .wiring.canvas <Configure> {setScrollBars; minsky.panopticon.width %w; minsky.panopticon.height %h; redrawPanopticon}
+# the panopticon thumbnail is rendered in the background, so display
+# it once ready. Polling only continues while a render is outstanding
+# and the panopticon is shown
+set panopticonPoll ""
+proc pollPanopticon {} {
+    global preferences panopticonPoll
+    set panopticonPoll ""
+    if {!$preferences(panopticon)} return
+    if {[minsky.panopticon.renderReady]} {panopticon.requestRedraw}
+    if {[minsky.panopticon.renderPending]} {
+        set panopticonPoll [after 200 pollPanopticon]
+    }
+}
+# redraw the panopticon, if shown, and poll for the thumbnail this renders
+proc redrawPanopticon {} {
+    global preferences panopticonPoll
+    if {!$preferences(panopticon)} return
+    panopticon.requestRedraw
+    if {$panopticonPoll==""} {set panopticonPoll [after 200 pollPanopticon]}
+}
 bind .equations.canvas <Configure> {setScrollBars}
 
 set helpTopics(.wiring.panopticon) Panopticon
@@ -754,12 +775,11 @@ proc setScrollBars {} {
 bind .tabs <<NotebookTabChanged>> {setScrollBars}
 
 proc panCanvas {offsx offsy} {
-    global preferences
     switch [lindex [.tabs tabs] [.tabs index current]] {
         .wiring {
             model.moveTo $offsx $offsy
             canvas.requestRedraw
-            if $preferences(panopticon) {panopticon.requestRedraw}
+            redrawPanopticon
         }
         .equations {
             equationDisplay.offsx $offsx
@@ -1008,16 +1028,37 @@ proc openFile {} {
     if [string length $ofname] {openNamedFile $ofname}
 }
 
+# display the progress of loading a model, as the fraction of the
+# file read. The progress window is removed once the fraction reaches 1
+proc loadProgress {fraction} {
+    if {$fraction>=1} {
+        if [winfo exists .loadProgress] {destroy .loadProgress}
+        return
+    }
+    if {![winfo exists .loadProgress]} {
+        toplevel .loadProgress
+        wm title .loadProgress "Loading"
+        wm transient .loadProgress .
+        ttk::progressbar .loadProgress.bar -maximum 1 -length 300
+        pack .loadProgress.bar -padx 10 -pady 10
+    }
+    .loadProgress.bar configure -value $fraction
+    update idletasks
+}
+
 proc openNamedFile {ofname} {
     global fname workDir preferences
     newSystem
     setFname $ofname
 
-    eval minsky.load $fname
+    if [catch {eval minsky.load $fname} err] {
+        loadProgress 1
+        error $err $::errorInfo
+    }
     doPushHistory 0
     pushFlags
     recentreCanvas
-    
+    redrawPanopticon
 
    .controls.simSpeed set [simulationDelay]
     # setting simulationDelay causes the edited (dirty) flag to be set
@@ -1191,6 +1232,7 @@ proc setPreferenceParms {} {
     setGodleyDisplay
     if {$preferences(panopticon)} {
         place .wiring.panopticon -relx 1 -rely 0 -anchor ne
+        redrawPanopticon
     } else {
         place forget .wiring.panopticon
     }
@@ -20,6 +20,7 @@
 #include "cairoItems.h"
 #include "minskyTCL.h"
 #include "minskyTCLObj.h"
+#include <math.h>
 #include <ecolab.h>
 #include <ecolab_epilogue.h>
 #ifdef _WIN32
@@ -29,23 +30,12 @@
 
 namespace minsky
 {
-  namespace
-  {
-    Minsky* l_minsky=NULL;
-  }
-
-  Minsky& minsky()
+  Minsky& globalMinsky()
   {
     static MinskyTCL s_minsky;
-    if (l_minsky)
-      return *l_minsky;
-    else
-      return s_minsky;
+    return s_minsky;
   }
 
-  LocalMinsky::LocalMinsky(Minsky& minsky) {l_minsky=&minsky;}
-  LocalMinsky::~LocalMinsky() {l_minsky=NULL;}
-
   cmd_data* getCommandData(const string& name)
   {
     Tcl_CmdInfo info;
@@ -211,6 +201,16 @@ namespace minsky
 #endif
     }
 
+  void MinskyTCL::loadProgress(double fraction)
+  {
+    // only update the progress bar for each percent loaded
+    if (fraction>=1 || fabs(fraction-lastLoadProgress)>=0.01)
+      {
+        lastLoadProgress=fraction;
+        tclcmd()<<"catch {loadProgress"<<fraction<<"}\n";
+      }
+  }
+
   void MinskyTCL::latex(const char* filename, bool wrapLaTeXLines) 
   {
     if (cycleCheck()) throw error("cyclic network detected");
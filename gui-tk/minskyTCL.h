@@ -73,6 +73,10 @@ namespace minsky
     void putClipboard(const std::string& s) const override; 
     std::string getClipboard() const override; 
 
+    /// fraction of the file last reported to the GUI's load progress bar
+    double lastLoadProgress=0;
+    void loadProgress(double fraction) override;
+
     std::set<string> matchingTableColumns(const std::string& currTable, GodleyAssetClass::AssetClass ac) {
       auto it=TCL_obj_properties().find(currTable);
       if (it!=TCL_obj_properties().end())
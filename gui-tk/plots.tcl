@@ -74,6 +74,17 @@ proc deiconifyPltWindowOptions {} {
         entry .pltWindowOptions.y1axislabel.val -width 20
         pack .pltWindowOptions.y1axislabel.label .pltWindowOptions.y1axislabel.val -side left
 
+        frame .pltWindowOptions.retention
+        label .pltWindowOptions.retention.samplesLabel -text "Max samples"
+        entry .pltWindowOptions.retention.samples -width 8
+        label .pltWindowOptions.retention.timeLabel -text "Max time"
+        entry .pltWindowOptions.retention.time -width 8
+        label .pltWindowOptions.retention.spillLabel -text "Spill to disk"
+        checkbutton .pltWindowOptions.retention.spill -variable plotWindowOptions(spill)
+        pack .pltWindowOptions.retention.samplesLabel .pltWindowOptions.retention.samples .pltWindowOptions.retention.timeLabel .pltWindowOptions.retention.time .pltWindowOptions.retention.spillLabel .pltWindowOptions.retention.spill -side left
+        tooltip .pltWindowOptions.retention.samplesLabel "Number of most recent samples held in memory. 0 is unlimited"
+        tooltip .pltWindowOptions.retention.timeLabel "Time range of samples held in memory. 0 is unlimited"
+
         pack .pltWindowOptions.title .pltWindowOptions.xaxislabel .pltWindowOptions.yaxislabel .pltWindowOptions.y1axislabel
 
         pack .pltWindowOptions.grid.label  .pltWindowOptions.grid.val  .pltWindowOptions.grid.sublabel  .pltWindowOptions.grid.subval  -side left
@@ -89,7 +100,7 @@ proc deiconifyPltWindowOptions {} {
         pack .pltWindowOptions.buttonBar.ok .pltWindowOptions.buttonBar.cancel -side left
         pack .pltWindowOptions.buttonBar -side bottom
 
-        pack .pltWindowOptions.xticks .pltWindowOptions.yticks .pltWindowOptions.grid .pltWindowOptions.legend .pltWindowOptions.logscale
+        pack .pltWindowOptions.xticks .pltWindowOptions.yticks .pltWindowOptions.grid .pltWindowOptions.legend .pltWindowOptions.logscale .pltWindowOptions.retention
     } else {
         wm deiconify .pltWindowOptions
     }
@@ -110,6 +121,9 @@ proc setPlotOptions {plot} {
     $plot.xlabel [.pltWindowOptions.xaxislabel.val get]
     $plot.ylabel [.pltWindowOptions.yaxislabel.val get]
     $plot.y1label [.pltWindowOptions.y1axislabel.val get]
+    $plot.maxSamples [.pltWindowOptions.retention.samples get]
+    $plot.maxTime [.pltWindowOptions.retention.time get]
+    $plot.spillToDisk $plotWindowOptions(spill)
     if {$plotWindowOptions(legend)=="none"} {
         $plot.legend 0
     } else {
@@ -128,6 +142,7 @@ proc doPlotOptions {plot} {
     set plotWindowOptions(subgrid) [$plot.subgrid]
     set plotWindowOptions(xlog) [$plot.logx]
     set plotWindowOptions(ylog) [$plot.logy]
+    set plotWindowOptions(spill) [$plot.spillToDisk]
     deiconifyPltWindowOptions
 
     .pltWindowOptions.xticks.val delete 0 end
@@ -142,6 +157,10 @@ proc doPlotOptions {plot} {
     .pltWindowOptions.yaxislabel.val insert 0 [$plot.ylabel]
     .pltWindowOptions.y1axislabel.val delete 0 end
     .pltWindowOptions.y1axislabel.val insert 0 [$plot.y1label]
+    .pltWindowOptions.retention.samples delete 0 end
+    .pltWindowOptions.retention.samples insert 0 [$plot.maxSamples]
+    .pltWindowOptions.retention.time delete 0 end
+    .pltWindowOptions.retention.time insert 0 [$plot.maxTime]
 
     .pltWindowOptions.buttonBar.ok configure -command "setPlotOptions $plot"
     global plotWindowOptions_legend
@@ -155,6 +174,33 @@ proc doPlotOptions {plot} {
     grab .pltWindowOptions
 }
 
+# show the plot's history, including samples spilled to disk, over
+# a user supplied x range
+proc plotShowHistory {plot} {
+    if {![winfo exists .plotHistory]} {
+        toplevel .plotHistory
+        wm title .plotHistory "Show history"
+        frame .plotHistory.range
+        label .plotHistory.range.minLabel -text "From"
+        entry .plotHistory.range.min -width 10
+        label .plotHistory.range.maxLabel -text "To"
+        entry .plotHistory.range.max -width 10
+        pack .plotHistory.range.minLabel .plotHistory.range.min .plotHistory.range.maxLabel .plotHistory.range.max -side left
+        pack .plotHistory.range
+        buttonBar .plotHistory "$plot.showHistory \[.plotHistory.range.min get\] \[.plotHistory.range.max get\]; canvas.requestRedraw"
+    } else {
+        wm deiconify .plotHistory
+    }
+    .plotHistory.range.min delete 0 end
+    .plotHistory.range.min insert 0 [t0]
+    .plotHistory.range.max delete 0 end
+    .plotHistory.range.max insert 0 [t]
+    wm transient .plotHistory
+    focus .plotHistory.range.min
+    tkwait visibility .plotHistory
+    grab set .plotHistory
+}
+
 # double click handling for plot (creates new toplevel plot window)
 proc plotDoubleClick {plotId} {
     toplevel .plot$plotId
@@ -162,10 +162,9 @@ proc zoom {factor} {
 }
 
 proc zoomAt {x0 y0 factor} {
-    global preferences
     canvas.model.zoom $x0 $y0 $factor
     canvas.requestRedraw
-    if $preferences(panopticon) panopticon.requestRedraw
+    redrawPanopticon
 }
 
 .menubar.ops add command -label "Godley Table" -command canvas.addGodley
@@ -494,6 +493,8 @@ proc contextMenu {x y X Y} {
             .wiring.context add command -label "Resize" -command "canvas.lassoMode itemResize"
             .wiring.context add command -label "Options" -command "doPlotOptions $item"
             .wiring.context add command -label "Export as CSV" -command exportItemAsCSV
+            .wiring.context add command -label "Show history" -command "plotShowHistory $item"
+            .wiring.context add command -label "Show latest" -command "$item.showLatest; canvas.requestRedraw"
         }
         "GodleyIcon" {
             .wiring.context add command -label "Open Godley Table" -command "openGodley [minsky.openGodley]"
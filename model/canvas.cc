@@ -30,6 +30,46 @@ using namespace minsky;
 
 namespace minsky
 {
+  namespace
+  {
+    /// sets the mouse focus of objects in \a grid near (\a x,\a y)
+    /// to \a inFocus(object), and clears that of objects in \a
+    /// previous that are no longer near, calling \a leave on
+    /// them. \a previous is updated to the objects now near.
+    /// @return true if any mouse focus changed
+    template <class T, class F, class L>
+    bool updateFocus(const SpatialGrid<T>& grid, vector<T>& previous,
+                     float x, float y, F inFocus, L leave)
+    {
+      bool changed=false;
+      vector<T> current;
+      grid.forEach(x,y,x,y,[&](const typename SpatialGrid<T>::Entry& e)
+                   {current.push_back(e.obj);});
+      auto setFocus=[&](const T& i, bool mf) {
+        if (i->mouseFocus!=mf)
+          {
+            i->mouseFocus=mf;
+            changed=true;
+          }
+      };
+      for (auto& i: previous)
+        if (find(current.begin(), current.end(), i)==current.end())
+          {
+            setFocus(i,false);
+            leave(i);
+          }
+      for (auto& i: current)
+        setFocus(i, inFocus(i));
+      previous.swap(current);
+      return changed;
+    }
+
+    template <class T, class F>
+    bool updateFocus(const SpatialGrid<T>& grid, vector<T>& previous,
+                     float x, float y, F inFocus)
+    {return updateFocus(grid, previous, x, y, inFocus, [](const T&){});}
+  }
+
   void Canvas::mouseDown(float x, float y)
   {
     // firstly, see if the user is selecting an item
@@ -65,8 +105,8 @@ namespace minsky
       }
     else
       {
-        wireFocus=model->findAny(&Group::wires,
-                       [&](const WirePtr& i){return i->near(x,y);});
+        index.update(model);
+        wireFocus=index.wires.find(x,y,[&](const WirePtr& i){return i->near(x,y);});
         if (wireFocus)
           handleSelected=wireFocus->nearestHandle(x,y);
         else
@@ -146,6 +186,8 @@ namespace minsky
   
   void Canvas::mouseMove(float x, float y)
   {
+    // sliders, ravels etc change appearance when dragged
+    if (itemFocus) itemFocus->renderCache.dirty=true;
     if (itemFocus && clickType==ClickType::onItem)
       {
         updateRegion=LassoBox(itemFocus->x(),itemFocus->y(),x,y);
@@ -226,61 +268,41 @@ namespace minsky
     else
       {
         // set mouse focus to display ports etc.
-        model->recursiveDo(&Group::items, [&](Items&,Items::iterator& i)
-                           {
-                             // with coupled integration variables, we
-                             // do not want to set mousefocus, as this
-                             // draws unnecessary port circles on the
-                             // variable
-                             if (!(*i)->visible() &&
-                                 dynamic_cast<Variable<VariableBase::integral>*>(i->get()))
-                               (*i)->mouseFocus=false;
-                             else
-                               {
-                                 auto ct=(*i)->clickType(x,y);
-                                 if (ct==ClickType::onRavel)
-                                   {
-                                     if (auto r=dynamic_cast<RavelWrap*>(i->get()))
-                                       if (r->onMouseOver(x,y))
-                                         requestRedraw();
-                                   }
-                                 else
-                                   {
-                                     auto mf = ct!=ClickType::outside;
-                                     if ((*i)->mouseFocus!=mf)
-                                       {
-                                         requestRedraw();
-                                         (*i)->mouseFocus=mf;
-                                       }
-                                     if (auto r=dynamic_cast<RavelWrap*>(i->get()))
-                                       {
-                                         r->onMouseLeave();
-                                         requestRedraw();
-                                       }
-                                   }
-                               }
-                             return false;
-                           });
-        model->recursiveDo(&Group::groups, [&](Groups&,Groups::iterator& i)
-                           {
-                             bool mf=(*i)->contains(x,y) && !(*i)->displayContents();
-                             if (mf!=(*i)->mouseFocus)
-                               {
-                                 (*i)->mouseFocus=mf;
-                                 requestRedraw();
-                               }        
-                             return false;
-                           });
-        model->recursiveDo(&Group::wires, [&](Wires&,Wires::iterator& i)
-                           {
-                             bool mf=(*i)->near(x,y);
-                             if (mf!=(*i)->mouseFocus)
-                               {
-                                 (*i)->mouseFocus=mf;
-                                 requestRedraw();
-                               }        
-                             return false;
-                           });
+        index.update(model);
+        auto leaveItem=[&](const ItemPtr& i) {
+          if (auto r=dynamic_cast<RavelWrap*>(i.get()))
+            {
+              r->onMouseLeave();
+              requestRedraw();
+            }
+        };
+        if (updateFocus(index.items, hoverItems, x, y, [&](const ItemPtr& i)
+                        {
+                          // with coupled integration variables, we
+                          // do not want to set mousefocus, as this
+                          // draws unnecessary port circles on the
+                          // variable
+                          if (!i->visible() &&
+                              dynamic_cast<Variable<VariableBase::integral>*>(i.get()))
+                            return false;
+                          auto ct=i->clickType(x,y);
+                          if (ct==ClickType::onRavel)
+                            {
+                              if (auto r=dynamic_cast<RavelWrap*>(i.get()))
+                                if (r->onMouseOver(x,y))
+                                  requestRedraw();
+                              return bool(i->mouseFocus);
+                            }
+                          leaveItem(i);
+                          return ct!=ClickType::outside;
+                        }, leaveItem))
+          requestRedraw();
+        if (updateFocus(index.groups, hoverGroups, x, y, [&](const GroupPtr& i)
+                        {return i->contains(x,y) && !i->displayContents();}))
+          requestRedraw();
+        if (updateFocus(index.wires, hoverWires, x, y, [&](const WirePtr& i)
+                        {return i->near(x,y);}))
+          requestRedraw();
       }
   }
 
@@ -292,29 +314,41 @@ namespace minsky
 
     if (!topLevel) topLevel=&*model;
 
-    for (auto& i: topLevel->items)
-      if (i->visible() && lasso.intersects(*i))
-        {
-          selection.items.push_back(i);
-          i->selected=true;
-          if (auto integ=dynamic_cast<IntOp*>(i.get()))
-            {
-              // ensure integral variable is selected too
-              selection.items.push_back(integ->intVar);
-              integ->intVar->selected=true;
-            }
-        }
+    index.update(model);
+    index.items.forEach
+      (lasso.x0,lasso.y0,lasso.x1,lasso.y1,[&](const SpatialGrid<ItemPtr>::Entry& e)
+       {
+         auto& i=e.obj;
+         if (e.group==topLevel && i->visible() && lasso.intersects(*i))
+           {
+             selection.items.push_back(i);
+             i->selected=true;
+             if (auto integ=dynamic_cast<IntOp*>(i.get()))
+               {
+                 // ensure integral variable is selected too
+                 selection.items.push_back(integ->intVar);
+                 integ->intVar->selected=true;
+               }
+           }
+       });
 
-    for (auto& i: topLevel->groups)
-      if (i->visible() && lasso.intersects(*i))
-        {
-          selection.groups.push_back(i);
-          i->selected=true;
-        }
+    index.groups.forEach
+      (lasso.x0,lasso.y0,lasso.x1,lasso.y1,[&](const SpatialGrid<GroupPtr>::Entry& e)
+       {
+         auto& i=e.obj;
+         if (e.group==topLevel && i->visible() && lasso.intersects(*i))
+           {
+             selection.groups.push_back(i);
+             i->selected=true;
+           }
+       });
 
-    for (auto& i: topLevel->wires)
-      if (i->visible() && lasso.contains(*i))
-        selection.wires.push_back(i);
+    index.wires.forEach
+      (lasso.x0,lasso.y0,lasso.x1,lasso.y1,[&](const SpatialGrid<WirePtr>::Entry& e)
+       {
+         if (e.group==topLevel && e.obj->visible() && lasso.contains(*e.obj))
+           selection.wires.push_back(e.obj);
+       });
 
     minsky().copy();
   }
@@ -322,18 +356,18 @@ namespace minsky
   
   ItemPtr Canvas::itemAt(float x, float y)
   {
-    auto item=model->findAny(&Group::items,
-                        [&](const ItemPtr& i){return i->visible() && i->contains(x,y);});
+    index.update(model);
+    auto item=index.items.find(x,y,[&](const ItemPtr& i){return i->visible() && i->contains(x,y);});
     if (!item)
-      item=model->findAny(&Group::groups,
-                       [&](const GroupPtr& i){return i->visible() && !i->displayContents() && i->contains(x,y);});
+      item=index.groups.find
+        (x,y,[&](const GroupPtr& i){return i->visible() && !i->displayContents() && i->contains(x,y);});
     return item;
   }
   
   void Canvas::getWireAt(float x, float y)
   {
-    wire=model->findAny(&Group::wires,
-                        [&](const WirePtr& i){return i->near(x,y);});
+    index.update(model);
+    wire=index.wires.find(x,y,[&](const WirePtr& i){return i->near(x,y);});
   }
 
   void Canvas::groupSelection()
@@ -525,6 +559,8 @@ namespace minsky
     if (auto item=itemAt(x,y))
       if (item->handleArrows(dir))
         {
+          // the displayed value has changed
+          item->renderCache.dirty=true;
           requestRedraw();
           minsky().pushHistory(); //for ticket #812
         }
@@ -594,6 +630,47 @@ namespace minsky
     redraw(-1e9,-1e9,2e9,2e9);
   }
 
+  void Canvas::drawItem(cairo_t* cairo, const Item& it)
+  {
+    cairo_save(cairo);
+    cairo_identity_matrix(cairo);
+    cairo_translate(cairo,it.x(), it.y());
+    if (it.mouseFocus)
+      {
+        // tooltips etc are transient, so not cached
+        it.draw(cairo);
+        it.bb.update(it);
+      }
+    else
+      {
+        auto& c=it.renderCache;
+        auto displayHash=it.displayHash();
+        if (c.dirty || !c.recording || c.generation!=renderGeneration ||
+            c.x!=it.x() || c.y!=it.y() || c.zoomFactor!=it.zoomFactor ||
+            c.rotation!=it.rotation || c.selected!=it.selected ||
+            c.displayHash!=displayHash)
+          {
+            // drawing also positions the item's ports, so the cache is
+            // keyed on its canvas position
+            c.recording.reset(new ecolab::cairo::Surface
+                              (cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA,NULL)));
+            cairo_set_line_width(c.recording->cairo(), 1);
+            it.draw(c.recording->cairo());
+            it.bb.update(it, c.recording->surface());
+            c.dirty=false;
+            c.generation=renderGeneration;
+            c.x=it.x(); c.y=it.y();
+            c.zoomFactor=it.zoomFactor;
+            c.rotation=it.rotation;
+            c.selected=it.selected;
+            c.displayHash=displayHash;
+          }
+        cairo_set_source_surface(cairo, c.recording->surface(), 0, 0);
+        cairo_paint(cairo);
+      }
+    cairo_restore(cairo);
+  }
+
   void Canvas::redrawUpdateRegion()
   {
     if (!surface.get()) return;
@@ -602,49 +679,41 @@ namespace minsky
     cairo_rectangle(cairo,updateRegion.x0,updateRegion.y0,updateRegion.x1-updateRegion.x0,updateRegion.y1-updateRegion.y0);
     cairo_clip(cairo);
     cairo_set_line_width(cairo, 1);
-    // items
-    model->recursiveDo
-      (&GroupItems::items, [&](const Items&, Items::const_iterator i)
+
+    // only items within the update region are drawn. Drawing may
+    // move them, so collect them before drawing.
+    index.update(model);
+    Items items;
+    index.items.forEach
+      (updateRegion.x0,updateRegion.y0,updateRegion.x1,updateRegion.y1,
+       [&](const SpatialGrid<ItemPtr>::Entry& e)
        {
-         auto& it=**i;
-         if (it.visible() && updateRegion.intersects(it))
-           {
-             cairo_save(cairo);
-             cairo_identity_matrix(cairo);
-             cairo_translate(cairo,it.x(), it.y());
-             it.draw(cairo);
-             it.bb.update(it);
-             cairo_restore(cairo);
-           }
-         return false;
+         if (e.obj->visible() && updateRegion.intersects(*e.obj))
+           items.push_back(e.obj);
        });
+    for (auto& i: items)
+      drawItem(cairo, *i);
 
     // groups
-    model->recursiveDo
-      (&GroupItems::groups, [&](const Groups&, Groups::const_iterator i)
+    Groups groups;
+    index.groups.forEach
+      (updateRegion.x0,updateRegion.y0,updateRegion.x1,updateRegion.y1,
+       [&](const SpatialGrid<GroupPtr>::Entry& e)
        {
-         auto& it=**i;
-         if (it.visible() && updateRegion.intersects(it))
-           {
-             cairo_save(cairo);
-             cairo_identity_matrix(cairo);
-             cairo_translate(cairo,it.x(), it.y());
-             it.draw(cairo);
-             it.bb.update(it);
-             cairo_restore(cairo);
-           }
-         return false;
+         if (e.obj->visible() && updateRegion.intersects(*e.obj))
+           groups.push_back(e.obj);
        });
-
-    // draw all wires - wires will go over the top of any icons. TODO
-    // introduce an ordering concept if needed
-    model->recursiveDo
-      (&GroupItems::wires, [&](const Wires&, Wires::const_iterator i)
+    for (auto& i: groups)
+      drawItem(cairo, *i);
+
+    // draw wires - wires will go over the top of any icons. TODO
+    // introduce an ordering concept if needed.
+    index.wires.forEach
+      (updateRegion.x0,updateRegion.y0,updateRegion.x1,updateRegion.y1,
+       [&](const SpatialGrid<WirePtr>::Entry& e)
        {
-         const Wire& w=**i;
-         if (w.visible()/* && updateRegion.intersects(w)*/)
-           w.draw(cairo);
-         return false;
+         if (e.obj->visible())
+           e.obj->draw(cairo);
        });
 
     if (fromPort.get()) // we're in process of creating a wire
@@ -27,6 +27,7 @@
 #include "switchIcon.h"
 #include "wire.h"
 #include "ravelWrap.h"
+#include "spatialIndex.h"
 #include <cairoSurfaceImage.h>
 
 #include <chrono>
@@ -50,6 +51,18 @@ namespace minsky
     CLASSDESC_ACCESS(Canvas);
     void copyVars(const std::vector<VariablePtr>&);
     void reportDrawTime(double) override;
+    /// spatial index of the model, for hit testing
+    Exclude<CanvasIndex> index;
+    /// objects near the mouse at the last mouseMove(), whose mouse
+    /// focus may need clearing on the next
+    Exclude<Items> hoverItems;
+    Exclude<Groups> hoverGroups;
+    Exclude<Wires> hoverWires;
+    /// incremented to discard all items' cached renderings
+    unsigned renderGeneration=1;
+    /// draw \a it at its canvas position, replaying its cached
+    /// rendering if still valid
+    void drawItem(cairo_t*, const Item& it);
   public:
     typedef std::chrono::time_point<std::chrono::high_resolution_clock> Timestamp;
     struct Model: public GroupPtr
@@ -62,8 +75,12 @@ namespace minsky
       Model(const GroupPtr& g) {operator=(g);}
       Model& operator=(const GroupPtr& model) {
         updateTimestamp();
+        // the geometry of both models is altered below, without
+        // notifying their index, so have it rebuilt
+        CanvasIndex::detach(*model);
         if (this->get())
           {
+            CanvasIndex::detach(**this);
             // restore previous stuff
             (*this)->group=parent;
             (*this)->m_x=px;
@@ -225,6 +242,9 @@ namespace minsky
     
     /// request a redraw on the screen
     void requestRedraw() {if (surface.get()) surface->requestRedraw();}
+    /// discard cached renderings of all items, for when something
+    /// affecting their appearance has changed
+    void invalidateRenderCache() {++renderGeneration;}
   };
 }
 
@@ -0,0 +1,313 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "dataSeries.h"
+#include <ecolab_epilogue.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace minsky
+{
+  namespace
+  {
+    const char binaryMagic[]="MINSKYD1";
+    const size_t magicSize=sizeof(binaryMagic)-1;
+    const size_t headerSize=magicSize+sizeof(uint64_t);
+
+    /// read-only view of the contents of a file
+    class FileContents
+    {
+    public:
+      FileContents(const string& fileName)
+      {
+#ifdef _WIN32
+        ifstream f(fileName, ios::binary);
+        if (!f)
+          throw runtime_error("failed to open "+fileName);
+        buffer.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+        m_data=buffer.data();
+        m_size=buffer.size();
+#else
+        int fd=open(fileName.c_str(), O_RDONLY);
+        if (fd<0)
+          throw runtime_error("failed to open "+fileName);
+        struct stat s;
+        bool ok=fstat(fd,&s)==0;
+        if (ok && s.st_size>0)
+          {
+            void* p=mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p!=MAP_FAILED)
+              {
+                mapped=true;
+                m_data=static_cast<const char*>(p);
+                m_size=s.st_size;
+                madvise(p, m_size, MADV_SEQUENTIAL);
+              }
+            else
+              ok=false;
+          }
+        close(fd);
+        if (!ok)
+          throw runtime_error("failed to read "+fileName);
+#endif
+      }
+      ~FileContents()
+      {
+#ifndef _WIN32
+        if (mapped)
+          munmap(const_cast<char*>(m_data), m_size);
+#endif
+      }
+      FileContents(const FileContents&)=delete;
+      void operator=(const FileContents&)=delete;
+
+      const char* data() const {return m_data;}
+      size_t size() const {return m_size;}
+    private:
+      const char* m_data="";
+      size_t m_size=0;
+#ifdef _WIN32
+      string buffer;
+#else
+      bool mapped=false;
+#endif
+    };
+
+    bool isSeparator(char c) {return c==' ' || c=='\t' || c==',' || c==';';}
+
+    /// parse a number from [p,end), returning false if none there
+    bool parseNumber(const char*& p, const char* end, double& x)
+    {
+      // strtod requires a null terminated string, so copy the token
+      // into a small buffer
+      char buf[64];
+      size_t n=0;
+      for (; p+n<end && n<sizeof(buf)-1 && !isSeparator(p[n]) && p[n]!='\n' && p[n]!='\r'; ++n)
+        buf[n]=p[n];
+      buf[n]='\0';
+      char* tail;
+      x=strtod(buf, &tail);
+      if (tail==buf) return false;
+      p+=tail-buf;
+      return true;
+    }
+  }
+
+  DataSeries::DataSeries(const map<double,double>& data)
+  {
+    m_x.reserve(data.size());
+    m_y.reserve(data.size());
+    for (auto& i: data)
+      {
+        m_x.push_back(i.first);
+        m_y.push_back(i.second);
+      }
+    checkUniform();
+  }
+
+  map<double,double> DataSeries::toMap() const
+  {
+    map<double,double> r;
+    for (size_t i=0; i<m_x.size(); ++i)
+      r.emplace_hint(r.end(), m_x[i], m_y[i]);
+    return r;
+  }
+
+  void DataSeries::assign(vector<double>&& x, vector<double>&& y)
+  {
+    if (x.size()!=y.size())
+      throw runtime_error("x and y data differ in length");
+    bool strictlyIncreasing=true;
+    for (size_t i=1; strictlyIncreasing && i<x.size(); ++i)
+      strictlyIncreasing=x[i-1]<x[i];
+    if (strictlyIncreasing)
+      {
+        m_x.swap(x);
+        m_y.swap(y);
+        checkUniform();
+        return;
+      }
+
+    // stable sort, so that of repeated x values, the last one read comes last
+    vector<size_t> order(x.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t i, size_t j) {return x[i]<x[j];});
+    m_x.clear(); m_y.clear();
+    for (size_t i=0; i<order.size(); ++i)
+      if (i+1==order.size() || x[order[i]]!=x[order[i+1]])
+        {
+          m_x.push_back(x[order[i]]);
+          m_y.push_back(y[order[i]]);
+        }
+    checkUniform();
+  }
+
+  void DataSeries::checkUniform()
+  {
+    m_dx=0;
+    size_t n=m_x.size();
+    if (n<2) return;
+    double dx=(m_x.back()-m_x.front())/(n-1);
+    // the index computed from dx is checked by lowerBound, so the
+    // spacing need only be close to uniform
+    for (size_t i=1; i<n; ++i)
+      if (abs(m_x[i]-m_x[i-1]-dx)>1e-6*dx)
+        return;
+    if (isfinite(dx)) m_dx=dx;
+  }
+
+  size_t DataSeries::lowerBound(double x, Cursor& cursor) const
+  {
+    size_t n=m_x.size(), i=min(cursor.index, n);
+    auto bounds=[&](size_t j) {return (j==0 || m_x[j-1]<x) && (j==n || m_x[j]>=x);};
+    // try the interval of the previous lookup, then the next one
+    // along, then one computed from the spacing of the x values,
+    // before resorting to a binary search
+    if (bounds(i))
+      return i;
+    if (i<n && bounds(i+1))
+      return cursor.index=i+1;
+    if (m_dx>0)
+      {
+        double guess=ceil((x-m_x[0])/m_dx);
+        if (guess>=0 && guess<=n)
+          {
+            i=guess;
+            if (bounds(i))
+              return cursor.index=i;
+            if (i<n && bounds(i+1))
+              return cursor.index=i+1;
+            if (i>0 && bounds(i-1))
+              return cursor.index=i-1;
+          }
+      }
+    return cursor.index=lower_bound(m_x.begin(), m_x.end(), x)-m_x.begin();
+  }
+
+  double DataSeries::interpolate(double x, Cursor& cursor) const
+  {
+    // not terribly sensible, but need to return something
+    if (m_x.empty()) return 0;
+
+    size_t i=lowerBound(x, cursor);
+    if (i==m_x.size())
+      return m_y.back();
+    else if (i==0)
+      return m_y[0];
+    else if (m_x[i] > x)
+      return (x-m_x[i-1])*(m_y[i]-m_y[i-1])/(m_x[i]-m_x[i-1])+m_y[i-1];
+    else
+      return m_y[i];
+  }
+
+  double DataSeries::deriv(double x, Cursor& cursor) const
+  {
+    size_t i=lowerBound(x, cursor);
+    if (i==m_x.size() || i==0)
+      return 0;
+    if (m_x[i]==x)
+      {
+        size_t j=i+1<m_x.size()? i+1: i;
+        return (m_y[j]-m_y[i-1])/(m_x[j]-m_x[i-1]);
+      }
+    else
+      return (m_y[i]-m_y[i-1])/(m_x[i]-m_x[i-1]);
+  }
+
+  void DataSeries::readText(const string& fileName)
+  {
+    FileContents f(fileName);
+    vector<double> x, y;
+    double pending;
+    bool havePending=false; // an x value awaiting its y value
+    for (const char* p=f.data(), *end=p+f.size(); p<end; )
+      {
+        // read numbers up to the end of the line, pairing them in
+        // order, so a line may hold several pairs, and a pair may be
+        // split across lines
+        for (;;)
+          {
+            while (p<end && isSeparator(*p)) ++p;
+            double v;
+            if (p==end || *p=='\n' || *p=='\r' || !parseNumber(p,end,v))
+              break;
+            if (havePending)
+              {
+                x.push_back(pending);
+                y.push_back(v);
+              }
+            else
+              pending=v;
+            havePending=!havePending;
+          }
+        // skip to the next line, including any text
+        p=static_cast<const char*>(memchr(p, '\n', end-p));
+        if (!p) break;
+        ++p;
+      }
+    assign(move(x), move(y));
+  }
+
+  bool DataSeries::isBinaryFile(const string& fileName)
+  {
+    ifstream f(fileName, ios::binary);
+    char magic[magicSize];
+    return f.read(magic, magicSize) && equal(magic, magic+magicSize, binaryMagic);
+  }
+
+  void DataSeries::readBinary(const string& fileName)
+  {
+    FileContents f(fileName);
+    uint64_t n;
+    if (f.size()<headerSize || !equal(binaryMagic, binaryMagic+magicSize, f.data()))
+      throw runtime_error(fileName+" is not a binary data file");
+    memcpy(&n, f.data()+magicSize, sizeof(n));
+    if ((f.size()-headerSize)/(2*sizeof(double))!=n)
+      throw runtime_error(fileName+" is truncated");
+    vector<double> x(n), y(n);
+    memcpy(x.data(), f.data()+headerSize, n*sizeof(double));
+    memcpy(y.data(), f.data()+headerSize+n*sizeof(double), n*sizeof(double));
+    assign(move(x), move(y));
+  }
+
+  void DataSeries::writeBinary(const string& fileName) const
+  {
+    ofstream f(fileName, ios::binary);
+    uint64_t n=m_x.size();
+    f.write(binaryMagic, magicSize);
+    f.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    f.write(reinterpret_cast<const char*>(m_x.data()), n*sizeof(double));
+    f.write(reinterpret_cast<const char*>(m_y.data()), n*sizeof(double));
+    if (!f)
+      throw runtime_error("failed to write "+fileName);
+  }
+}
@@ -0,0 +1,93 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DATASERIES_H
+#define DATASERIES_H
+
+#include "classdesc_access.h"
+#include <map>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace minsky
+{
+  /**
+     A function y(x) tabulated at strictly increasing values of x,
+     held in contiguous arrays. Lookups start from a Cursor recording
+     where the previous lookup ended, so a sequence of nearly
+     monotone arguments, such as simulation time, costs O(1) per
+     lookup rather than a binary search. Where the x values are
+     evenly spaced, other lookups compute the index directly.
+  */
+  class DataSeries
+  {
+    CLASSDESC_ACCESS(DataSeries);
+    std::vector<double> m_x, m_y;
+    double m_dx=0; ///< spacing of x values if uniform, otherwise 0
+    void checkUniform();
+  public:
+    /// position of a previous lookup
+    struct Cursor
+    {
+      size_t index=0;
+    };
+
+    DataSeries() {}
+    explicit DataSeries(const std::map<double,double>&);
+    std::map<double,double> toMap() const;
+
+    /// assign from (x,y) pairs in any order. Where x values are
+    /// repeated, the last corresponding y value is retained.
+    void assign(std::vector<double>&& x, std::vector<double>&& y);
+
+    size_t size() const {return m_x.size();}
+    bool empty() const {return m_x.empty();}
+    void clear() {m_x.clear(); m_y.clear(); m_dx=0;}
+    const std::vector<double>& x() const {return m_x;}
+    const std::vector<double>& y() const {return m_y;}
+    /// true if the x values are evenly spaced
+    bool uniform() const {return m_dx>0;}
+
+    /// index of the first x value not less than \a x
+    size_t lowerBound(double x, Cursor&) const;
+    /// interpolates y data between x values bounding the argument
+    double interpolate(double x, Cursor&) const;
+    /// derivative of the interpolate function. At the data points, the
+    /// derivative is defined as the weighted average of the left & right
+    /// derivatives, weighted by the respective intervals
+    double deriv(double x, Cursor&) const;
+
+    /// read pairs of numbers from a text file, separated by
+    /// whitespace, commas or semicolons. Numbers are paired in order,
+    /// so a line may hold several pairs, or a pair may span lines. The
+    /// remainder of a line is skipped from the first token that is
+    /// not a number, so column headings and comments are ignored.
+    void readText(const std::string& fileName);
+    /// binary format: the magic string, the number of points n as a
+    /// 64 bit integer, then n x values followed by n y values, all in
+    /// native byte order
+    void readBinary(const std::string& fileName);
+    void writeBinary(const std::string& fileName) const;
+    static bool isBinaryFile(const std::string& fileName);
+  };
+}
+
+#include "dataSeries.cd"
+#include "dataSeries.xcd"
+#endif
@@ -0,0 +1,109 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "deltaHistory.h"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+namespace minsky
+{
+  const size_t DeltaHistory::keyframeInterval;
+
+  bool DeltaHistory::push(const char* data, size_t size)
+  {
+    if (!entries.empty() && size==last.size() && equal(data, data+size, last.begin()))
+      return false;
+
+    entries.emplace_back();
+    auto& e=entries.back();
+    if (entries.size()==1 || sinceKeyframe+1>=keyframeInterval)
+      {
+        e.keyframe=true;
+        e.data.assign(data, data+size);
+        sinceKeyframe=0;
+      }
+    else
+      {
+        size_t n=min(size, last.size());
+        auto p=mismatch(last.begin(), last.begin()+n, data);
+        e.prefix=p.first-last.begin();
+        while (e.suffix<n-e.prefix && last[last.size()-e.suffix-1]==data[size-e.suffix-1])
+          ++e.suffix;
+        e.data.assign(data+e.prefix, data+size-e.suffix);
+        ++sinceKeyframe;
+      }
+    last.assign(data, data+size);
+    return true;
+  }
+
+  void DeltaHistory::apply(const Entry& delta, vector<char>& state)
+  {
+    if (delta.keyframe)
+      state=delta.data;
+    else
+      {
+        state.erase(state.begin()+delta.prefix, state.end()-delta.suffix);
+        state.insert(state.begin()+delta.prefix, delta.data.begin(), delta.data.end());
+      }
+  }
+
+  void DeltaHistory::get(size_t i, vector<char>& state) const
+  {
+    if (i>=entries.size())
+      throw runtime_error("history index out of range");
+    if (i+1==entries.size())
+      {
+        state=last;
+        return;
+      }
+    size_t k=i;
+    while (!entries[k].keyframe) --k;
+    for (; k<=i; ++k)
+      apply(entries[k], state);
+  }
+
+  void DeltaHistory::truncate(size_t n)
+  {
+    if (n>=entries.size()) return;
+    if (n==0)
+      {
+        clear();
+        return;
+      }
+    size_t first=entries.size()-n;
+    if (!entries[first].keyframe)
+      {
+        // the new oldest state has to stand on its own
+        vector<char> state;
+        get(first, state);
+        entries[first].keyframe=true;
+        entries[first].prefix=entries[first].suffix=0;
+        entries[first].data.swap(state);
+      }
+    entries.erase(entries.begin(), entries.begin()+first);
+  }
+
+  size_t DeltaHistory::memoryUsage() const
+  {
+    size_t r=last.capacity();
+    for (auto& e: entries)
+      r+=sizeof(e)+e.data.capacity();
+    return r;
+  }
+}
@@ -0,0 +1,75 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DELTAHISTORY_H
+#define DELTAHISTORY_H
+
+#include <deque>
+#include <stddef.h>
+#include <vector>
+
+namespace minsky
+{
+  /**
+     A sequence of serialised states, such as the undo history of a
+     model. Each state is stored as a delta from its predecessor,
+     consisting of the bytes lying between the prefix and suffix the
+     two have in common, so that an edit costs memory in proportion
+     to the size of the change. Every keyframeInterval states a
+     keyframe is stored in full, bounding the cost of reconstructing
+     a state.
+  */
+  class DeltaHistory
+  {
+  public:
+    static const size_t keyframeInterval=16;
+
+    size_t size() const {return entries.size();}
+    bool empty() const {return entries.empty();}
+    void clear() {entries.clear(); last.clear(); sinceKeyframe=0;}
+    /// append a state
+    /// @return false if identical to the latest state, which is not
+    /// then appended
+    bool push(const char* data, size_t size);
+    /// reconstruct state \a i into \a state
+    void get(size_t i, std::vector<char>& state) const;
+    /// latest state
+    const std::vector<char>& back() const {return last;}
+    /// discard the oldest states, retaining the latest \a n
+    void truncate(size_t n);
+    /// number of bytes held by stored states
+    size_t memoryUsage() const;
+
+  private:
+    struct Entry
+    {
+      bool keyframe=false;
+      /// lengths of the prefix and suffix in common with the previous
+      /// state, which together with data make up this state
+      size_t prefix=0, suffix=0;
+      std::vector<char> data;
+    };
+    std::deque<Entry> entries;
+    std::vector<char> last;
+    size_t sinceKeyframe=0; ///< number of deltas since the last keyframe
+    /// apply \a delta to \a state in place
+    static void apply(const Entry& delta, std::vector<char>& state);
+  };
+}
+
+#endif
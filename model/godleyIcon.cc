@@ -205,6 +205,7 @@ namespace minsky
 
   void GodleyIcon::update()
   {
+    renderCache.dirty=true;
     updateVars(m_stockVars, table.getColumnVariables(), VariableType::stock);
     updateVars(m_flowVars, table.getVariables(), VariableType::flow);
 
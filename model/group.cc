@@ -24,6 +24,7 @@
 #include "minsky.h"
 #include <cairo_base.h>
 #include <ecolab_epilogue.h>
+#include <boost/functional/hash.hpp>
 using namespace std;
 using namespace ecolab::cairo;
 
@@ -109,6 +110,7 @@ namespace minsky
         {
           ItemPtr r=*i;
           items.erase(i);
+          CanvasIndex::removed(*r);
           if (r->ioVar())
             {
               remove(inVariables, r);
@@ -124,6 +126,7 @@ namespace minsky
         {
           ItemPtr r=*i;
           groups.erase(i);
+          CanvasIndex::removed(*r);
           return r;
         }
     
@@ -142,6 +145,7 @@ namespace minsky
         {
           WirePtr r=*i;
           wires.erase(i);
+          CanvasIndex::removed(*r);
           return r;
         }
 
@@ -158,6 +162,7 @@ namespace minsky
         {
           GroupPtr r=*i;
           groups.erase(i);
+          CanvasIndex::removed(*r);
           return r;
         }
 
@@ -263,6 +268,7 @@ namespace minsky
             addItem(intOp->intVar,inSchema);
         }
     items.push_back(it);
+    CanvasIndex::added(it);
     return items.back();
   }
 
@@ -476,6 +482,7 @@ namespace minsky
     resizeItems(items,sx,sy);
     resizeItems(groups,sx,sy);
     bb.update(*this);
+    CanvasIndex::moved(*this);
   }
   
   bool Group::nocycles() const
@@ -497,6 +504,7 @@ namespace minsky
     groups.push_back(g);
     g->group=self;
     g->self=groups.back();
+    CanvasIndex::added(g);
     assert(nocycles());
     return groups.back();
   }
@@ -505,6 +513,7 @@ namespace minsky
   {
     assert(w->from() && w->to());
     wires.push_back(w);
+    CanvasIndex::added(w, self);
     return wires.back();
   }
   WirePtr GroupItems::addWire
@@ -681,11 +690,11 @@ namespace minsky
   void Group::setZoom(float factor)
   {
     bool dpc=displayContents();
-    zoomFactor=factor;
+    setGeometry(*this,zoomFactor,factor);
     computeDisplayZoom();
     float lzoom=localZoom();
     for (auto& i: items)
-      i->zoomFactor=lzoom;
+      setGeometry(*i,i->zoomFactor,lzoom);
     m_displayContentsChanged = dpc!=displayContents();
     for (auto& i: groups)
       {
@@ -701,6 +710,7 @@ namespace minsky
     minsky::zoom(m_x,xOrigin+m_x-x(),factor);
     minsky::zoom(m_y,yOrigin+m_y-y(),factor);
     zoomFactor*=factor;
+    CanvasIndex::moved(*this);
     m_displayContentsChanged = dpc!=displayContents();
     for (auto& i: items)
       {
@@ -718,6 +728,13 @@ namespace minsky
   }
 
 
+  size_t Group::displayHash() const
+  {
+    auto h=Item::displayHash();
+    boost::hash_combine(h, title);
+    return h;
+  }
+
   void Group::draw(cairo_t* cairo) const
   {
     double angle=rotation * M_PI / 180.0;
@@ -835,9 +852,9 @@ namespace minsky
         Rotate r(rotation,0,0);
         auto& v=vars[i];
         v->m_visible=false;
-        v->m_x=r.x(x,y); v->m_y=r.y(x,y);
+        setGeometry(*v,v->m_x,r.x(x,y)); setGeometry(*v,v->m_y,r.y(x,y));
         v->rotation=rotation;
-        v->zoomFactor=0.75*edgeScale();
+        setGeometry(*v,v->zoomFactor,0.75*edgeScale());
         cairo::CairoSave cs(cairo);
         cairo_translate(cairo,zoomFactor*x,zoomFactor*y);
         cairo_rotate(cairo,M_PI*rotation/180);
@@ -925,14 +942,14 @@ namespace minsky
     left=right=10*scale;
     for (auto& i: inVariables)
       {
-        i->zoomFactor=edgeScale();
+        setGeometry(*i,i->zoomFactor,edgeScale());
         float w= scale*(2*RenderVariable(*i).width()+2);
         assert(i->type()!=VariableType::undefined);
         if (w>left) left=w;
       }
     for (auto& i: outVariables)
       {
-        i->zoomFactor=edgeScale();
+        setGeometry(*i,i->zoomFactor,edgeScale());
         float w= scale*(2*RenderVariable(*i).width()+2);
         assert(i->type()!=VariableType::undefined);
         if (w>right) right=w;
@@ -28,6 +28,7 @@
 #include "variable.h"
 #include <function.h>
 #include "SVGItem.h"
+#include "spatialIndex.h"
 
 namespace minsky
 {
@@ -46,8 +47,14 @@ namespace minsky
     GroupItems(const GroupItems& x) {};
     GroupItems& operator=(const GroupItems&) {return *this;}
     std::weak_ptr<Group> self; ///< weak ref to this
+    /// index of this group, while displayed on a canvas, which is
+    /// notified of changes to its contents
+    classdesc::Exclude<CanvasIndexRef> canvasIndex;
     
     void clear() {
+      for (auto& i: items) CanvasIndex::removed(*i);
+      for (auto& i: groups) CanvasIndex::removed(*i);
+      for (auto& i: wires) CanvasIndex::removed(*i);
       items.clear();
       groups.clear();
       wires.clear();
@@ -185,6 +192,7 @@ namespace minsky
     std::vector<VariablePtr> createdIOvariables;
     
     bool nocycles() const override; 
+    size_t displayHash() const override;
 
     GroupPtr copy() const;
     Group* clone() const override {throw error("Groups cannot be cloned");}
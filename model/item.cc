@@ -24,9 +24,11 @@
 #include "latexMarkup.h"
 #include "geometry.h"
 #include "selection.h"
+#include "spatialIndex.h"
 #include <pango.h>
 #include <cairo_base.h>
 #include <ecolab_epilogue.h>
+#include <boost/functional/hash.hpp>
 #include <exception>
 
 using ecolab::Pango;
@@ -46,15 +48,19 @@ namespace minsky
       {cerr<<"illegal exception caught in draw()"<<e.what()<<endl;}
     catch (...) {cerr<<"illegal exception caught in draw()";}
     x.mouseFocus=savedMouseFocus;
+    update(x, surf.surface());
+  }
+
+  void BoundingBox::update(const Item& x, cairo_surface_t* recording)
+  {
     double l,t,w,h;
-    cairo_recording_surface_ink_extents(surf.surface(),
-                                        &l,&t,&w,&h);
+    cairo_recording_surface_ink_extents(recording,&l,&t,&w,&h);
     // note (0,0) is relative to the (x,y) of icon.
     double invZ=1/x.zoomFactor;
-    left=l*invZ;
-    right=(l+w)*invZ;
-    top=t*invZ;
-    bottom=(t+h)*invZ;
+    setGeometry(x,left,l*invZ);
+    setGeometry(x,right,(l+w)*invZ);
+    setGeometry(x,top,t*invZ);
+    setGeometry(x,bottom,(t+h)*invZ);
   }
 
   float Item::x() const 
@@ -92,13 +98,13 @@ namespace minsky
   {
     if (auto g=group.lock())
       {
-        m_x=(x-g->x())/g->zoomFactor;
-        m_y=(y-g->y())/g->zoomFactor;
+        setGeometry(*this,m_x,(x-g->x())/g->zoomFactor);
+        setGeometry(*this,m_y,(y-g->y())/g->zoomFactor);
       }
     else
       {
-        m_x=x;
-        m_y=y;
+        setGeometry(*this,m_x,x);
+        setGeometry(*this,m_y,y);
       }
     assert(abs(x-this->x())<1 && abs(y-this->y())<1);
   }
@@ -134,7 +140,7 @@ namespace minsky
 //            minsky::zoom(m_x,xOrigin-g->x(),factor);
 //            minsky::zoom(m_y,yOrigin-g->y(),factor);
 //          }
-        zoomFactor*=factor;
+        setGeometry(*this,zoomFactor,zoomFactor*factor);
       }
   }
 
@@ -217,6 +223,14 @@ namespace minsky
       }
   }
 
+  size_t Item::displayHash() const
+  {
+    size_t h=0;
+    boost::hash_combine(h, tooltip);
+    boost::hash_combine(h, detailedText);
+    return h;
+  }
+
   shared_ptr<Port> Item::closestOutPort(float x, float y) const 
   {
     if (auto v=select(x,y))
@@ -26,6 +26,7 @@
 #include <TCL_obj_base.h>
 
 #include <cairo.h>
+#include <cmath>
 #include <vector>
 #include <cairo_base.h>
 
@@ -59,9 +60,11 @@ namespace minsky
   /// bounding box information (at zoom=1 scale)
   class BoundingBox
   {
-    float left=0, right=0, top, bottom;
+    float left=0, right=0, top=0, bottom=0;
   public:
     void update(const Item& x);
+    /// update from a recording \a recording of \a x being drawn
+    void update(const Item& x, cairo_surface_t* recording);
     bool contains(float x, float y) const {
       return left<=x && right>=x && bottom>=y && top<=y;
     }
@@ -70,6 +73,28 @@ namespace minsky
     float height() const {return bottom-top;}
   };
 
+  /// a recording of an item's drawing, which the canvas replays in
+  /// place of redrawing the item until it is invalidated
+  struct RenderCache
+  {
+    classdesc::Exclude<ecolab::cairo::SurfacePtr> recording;
+    /// set when the item's appearance may have changed
+    bool dirty=true;
+    /// state of the item, and canvas render generation, at the time of recording
+    float x=0, y=0, zoomFactor=0;
+    double rotation=0;
+    bool selected=false;
+    unsigned generation=0;
+    /// Item::appearanceValue() as of the last step
+    double value=std::nan("");
+    /// Item::displayHash() at the time of recording
+    size_t displayHash=0;
+    RenderCache() {}
+    /// copies are rerendered, as drawing positions their own ports
+    RenderCache(const RenderCache&) {}
+    RenderCache& operator=(const RenderCache&) {return *this;}
+  };
+
   class Item: virtual public NoteBase
   {
   public:
@@ -135,6 +160,18 @@ namespace minsky
     
     /// update display after a step()
     virtual void updateIcon(double t) {}
+    /// true if this item's appearance may change as the simulation
+    /// runs, so its cached rendering is discarded after each step
+    virtual bool dynamicAppearance() const {return true;}
+    /// the value displayed by an item with dynamicAppearance(). Its
+    /// cached rendering is only discarded after a step if this
+    /// changes. NaN, the default, discards it after every step.
+    virtual double appearanceValue() const {return std::nan("");}
+    /// hash of the state, other than position, zoom, rotation and
+    /// selection, that this item's drawing depends on. Its cached
+    /// rendering is discarded when this changes
+    virtual size_t displayHash() const;
+    mutable classdesc::Exclude<RenderCache> renderCache;
     virtual ~Item() {}
 
     void drawPorts(cairo_t* cairo) const;
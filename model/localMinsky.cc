@@ -0,0 +1,43 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The minsky() accessor, shared by the GUI and batch executables,
+// which each supply the default Minsky object via globalMinsky()
+
+#include "minsky.h"
+#include <ecolab_epilogue.h>
+
+namespace minsky
+{
+  namespace
+  {
+    thread_local Minsky* l_minsky=NULL;
+  }
+
+  Minsky& minsky()
+  {
+    if (l_minsky)
+      return *l_minsky;
+    else
+      return globalMinsky();
+  }
+
+  LocalMinsky::LocalMinsky(Minsky& minsky) {l_minsky=&minsky;}
+  LocalMinsky::~LocalMinsky() {l_minsky=NULL;}
+}
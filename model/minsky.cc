@@ -32,7 +32,9 @@
 #include <cairo/cairo-pdf.h>
 #include <cairo/cairo-svg.h>
 
+#include <boost/filesystem.hpp>
 #include <thread>
+#include <zlib.h>
 using namespace std;
 
 using namespace minsky;
@@ -139,18 +141,77 @@ namespace minsky
 
 
 #include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
 using namespace std;
 
 namespace minsky
 {
   void Minsky::openLogFile(const string& name)
   {
-    outputDataFile.reset(new ofstream(name));
-    *outputDataFile<< "#time";
-    for (auto& v: variableValues)
-      if (logVarList.count(v.first))
-        *outputDataFile<<" "<<v.second.name;
-    *outputDataFile<<endl;
+    closeLogFile();
+    if (boost::filesystem::path(name).extension()==".mlog")
+      {
+        binaryLogName=name;
+        csvLogName.clear();
+      }
+    else
+      {
+        using namespace boost::filesystem;
+        binaryLogName=(temp_directory_path()/unique_path("minsky-%%%%-%%%%-%%%%.mlog")).string();
+        csvLogName=name;
+      }
+    vector<VariableLog::Column> columns{{"time",timeUnit}};
+    loggedIds.clear();
+    for (auto& v: logVarList)
+      {
+        auto i=variableValues.find(v);
+        if (i!=variableValues.end())
+          {
+            columns.emplace_back(i->second.name, i->second.units.str());
+            loggedIds.push_back(v);
+          }
+      }
+    outputDataFile.reset(new VariableLog(binaryLogName, columns));
+    resolveLoggedValues();
+  }
+
+  void Minsky::closeLogFile()
+  {
+    auto log=move(outputDataFile);
+    if (!log) return;
+    try
+      {
+        log->flush();
+        log.reset();
+        if (!csvLogName.empty())
+          {
+            ifstream in(binaryLogName, ios::binary);
+            ofstream csv(csvLogName);
+            logToCSV(in, csv);
+            if (!csv)
+              throw error("failed to write %s", csvLogName.c_str());
+          }
+      }
+    catch (...)
+      {
+        if (!csvLogName.empty())
+          boost::filesystem::remove(binaryLogName);
+        throw;
+      }
+    if (!csvLogName.empty())
+      boost::filesystem::remove(binaryLogName);
+  }
+
+  void Minsky::resolveLoggedValues()
+  {
+    loggedValues.clear();
+    for (auto& id: loggedIds)
+      {
+        auto i=variableValues.find(id);
+        loggedValues.push_back(i!=variableValues.end()? &i->second: nullptr);
+      }
   }
 
   /// write current state of all variables to the log file
@@ -158,11 +219,10 @@ namespace minsky
   {
     if (outputDataFile)
       {
-        *outputDataFile<<t;
-        for (auto& v: variableValues)
-          if (logVarList.count(v.first))
-            *outputDataFile<<" "<<v.second.value();
-        *outputDataFile<<endl;
+        double* row=outputDataFile->nextRow();
+        row[0]=t;
+        for (size_t i=0; i<loggedValues.size(); ++i)
+          row[i+1]=loggedValues[i]? loggedValues[i]->value(): nan("");
       }
   }        
         
@@ -172,8 +232,10 @@ namespace minsky
   {
     model->clear();
     equations.clear();
+    compiledEquations.clear();
     integrals.clear();
     variableValues.clear();
+    equationSignature=0;
     
     flowVars.clear();
     stockVars.clear();
@@ -317,6 +379,7 @@ namespace minsky
     stockVars.clear();
     flowVars.clear();
     equations.clear();
+    compiledEquations.clear();
     integrals.clear();
 
     // remove all temporaries
@@ -351,13 +414,14 @@ namespace minsky
     assert(variableValues.validEntries());
     system.populateEvalOpVector(equations, integrals);
     assert(variableValues.validEntries());
+    compiledEquations.compile(equations);
 
     // perform dimensional analysis on the integral variables
     for (auto& i: integrals)
       {
         auto& stockUnits=variableValues[i.stock.valueId()].units;
         stockUnits=i.input.units;
-        if (!EvalOpBase::timeUnit.empty())
+        if (!timeUnit.empty())
           {
             auto& tu=stockUnits[timeUnit];
             tu++;
@@ -365,6 +429,8 @@ namespace minsky
               stockUnits.erase(timeUnit);
           }
       }
+    // after the dimensional analysis, as stock units are hashed
+    equationSignature=structuralSignature();
     
     // attach the plots
     model->recursiveDo
@@ -611,15 +677,17 @@ namespace minsky
                                  GodleyIt(godleyItems.end()), variableValues);
   }
 
-  void Minsky::reset()
+  void Minsky::initSimulation()
   {
-    EvalOpBase::t=t=t0;
-    constructEquations();
     // if no stock variables in system, add a dummy stock variable to
     // make the simulation proceed
     if (stockVars.empty()) stockVars.resize(1,0);
+    workspace.resize(stockVars.size(), flowVars.size());
 
     initGodleys();
+    computeJacobianSparsity();
+    if (outputDataFile)
+      resolveLoggedValues();
 
     if (stockVars.size()>0)
       {
@@ -632,6 +700,13 @@ namespace minsky
     flags &= ~reset_needed;
     // update flow variable
     evalEquations();
+  }
+
+  void Minsky::reset()
+  {
+    EvalOpBase::t=t=t0;
+    constructEquations();
+    initSimulation();
     
     model->recursiveDo
       (&Group::items,
@@ -646,20 +721,191 @@ namespace minsky
            }
          return false;
        });
+    canvas.invalidateRenderCache();
     canvas.requestRedraw();
   }
 
+  namespace
+  {
+    /// FNV-1a hash of the values streamed into it
+    struct StructureHash
+    {
+      uint64_t h=14695981039346656037ULL;
+      void bytes(const void* p, size_t n) {
+        auto c=static_cast<const unsigned char*>(p);
+        for (size_t i=0; i<n; ++i)
+          h=(h^c[i])*1099511628211ULL;
+      }
+      template <class T>
+      typename enable_if<is_arithmetic<T>::value||is_enum<T>::value, StructureHash&>::type
+      operator<<(T x) {bytes(&x,sizeof(x)); return *this;}
+      StructureHash& operator<<(const string& x)
+      {*this<<x.size(); bytes(x.data(),x.size()); return *this;}
+    };
+  }
+
+  uint64_t Minsky::structuralSignature() const
+  {
+    // walk the model directly, hashing only the attributes
+    // contributing to the equations, as serialising it is far more
+    // expensive
+
+    // number objects in traversal order, so that references between
+    // them hash consistently
+    unordered_map<const Item*, int> ids;
+    auto addId=[&](const Item* i) {ids.emplace(i, ids.size());};
+    model->recursiveDo
+      (&GroupItems::items, [&](const Items&, Items::const_iterator i)
+       {
+         addId(i->get());
+         // Godley tables' variables are attached to wires, but not
+         // held in groups
+         if (auto g=dynamic_cast<const GodleyIcon*>(i->get()))
+           {
+             for (auto& v: g->flowVars()) addId(v.get());
+             for (auto& v: g->stockVars()) addId(v.get());
+           }
+         return false;
+       });
+    model->recursiveDo
+      (&GroupItems::groups, [&](const Groups&, Groups::const_iterator i)
+       {addId(i->get()); return false;});
+    auto id=[&](const Item* i) {
+      auto j=ids.find(i);
+      return j==ids.end()? -1: j->second;
+    };
+
+    StructureHash h;
+    model->recursiveDo
+      (&GroupItems::items, [&](const Items&, Items::const_iterator it)
+       {
+         auto& i=**it;
+         // the equations refer to the items they were built from, so
+         // replacing an item by an equivalent one (eg by cut and
+         // paste, or undo) requires them to be rebuilt
+         h<<reinterpret_cast<uintptr_t>(&i);
+         h<<i.classType()<<id(i.group.lock().get())<<i.ports.size();
+         if (auto v=dynamic_cast<const VariableBase*>(&i))
+           {
+             h<<v->rawName()<<v->valueId();
+             auto vv=variableValues.find(v->valueId());
+             if (vv!=variableValues.end())
+               h<<vv->second.units.str();
+             // initial values of these are applied by
+             // updateEquations without reconstructing
+             // equations. Constants' values are folded into the
+             // equations, so are structural.
+             if (v->type()!=VariableType::parameter && v->type()!=VariableType::stock &&
+                 v->type()!=VariableType::integral)
+               h<<v->init();
+           }
+         if (auto o=dynamic_cast<const IntOp*>(&i))
+           h<<id(o->intVar.get())<<o->coupled();
+         if (auto d=dynamic_cast<const DataOp*>(&i))
+           {
+             h<<d->description;
+             for (auto x: d->data.x()) h<<x;
+             for (auto y: d->data.y()) h<<y;
+           }
+         if (auto r=dynamic_cast<const RavelWrap*>(&i))
+           {
+             pack_t buf;
+             buf<<r->getState();
+             h<<r->filename();
+             h.bytes(buf.data(), buf.size());
+           }
+         if (auto g=dynamic_cast<const GodleyIcon*>(&i))
+           {
+             for (auto& row: g->table.getData())
+               {
+                 h<<row.size();
+                 for (auto& cell: row) h<<cell;
+               }
+             for (auto c: g->table._assetClass()) h<<c;
+           }
+         return false;
+       });
+    model->recursiveDo
+      (&GroupItems::groups, [&](const Groups&, Groups::const_iterator i)
+       {
+         auto& g=**i;
+         h<<id(g.group.lock().get())<<g.ports.size();
+         h<<g.inVariables.size();
+         for (auto& v: g.inVariables) h<<id(v.get());
+         h<<g.outVariables.size();
+         for (auto& v: g.outVariables) h<<id(v.get());
+         return false;
+       });
+    // wires, by the positions of the ports they connect
+    auto hashPort=[&](const Port& p) {
+      h<<id(&p.item);
+      for (size_t j=0; j<p.item.ports.size(); ++j)
+        if (p.item.ports[j].get()==&p)
+          h<<j;
+    };
+    model->recursiveDo
+      (&GroupItems::wires, [&](const Wires&, Wires::const_iterator w)
+       {
+         auto f=(*w)->from(), t=(*w)->to();
+         if (f && t)
+           {
+             hashPort(*f);
+             hashPort(*t);
+           }
+         return false;
+       });
+    h<<timeUnit;
+    return h.h;
+  }
+
+  void Minsky::updateEquations()
+  {
+    bool started=t>t0;
+    if (structuralSignature()==equationSignature)
+      {
+        // structure unchanged, so only initial values need to be
+        // applied: all of them if the simulation is yet to start,
+        // otherwise just the parameters
+        for (auto& v: variableValues)
+          if (!v.second.temp() && v.second.idx()>=0 &&
+              (!started || v.second.type()==VariableType::parameter))
+            v.second.reset(variableValues);
+      }
+    else if (started)
+      {
+        // carry stock values across the reconstruction, where the
+        // stock still exists with the same shape
+        map<string, vector<double>> stocks;
+        for (auto& v: variableValues)
+          if (!v.second.isFlowVar() && v.second.idx()>=0)
+            stocks[v.first].assign(v.second.begin(), v.second.end());
+        constructEquations();
+        for (auto& s: stocks)
+          {
+            auto v=variableValues.find(s.first);
+            if (v!=variableValues.end() && !v->second.isFlowVar() &&
+                v->second.idx()>=0 && v->second.numElements()==s.second.size())
+              copy(s.second.begin(), s.second.end(), v->second.begin());
+          }
+        EvalOpBase::t=t;
+      }
+    else
+      {
+        reset();
+        return;
+      }
+    initSimulation();
+  }
+
   void Minsky::step()
   {
     if (reset_flag())
-      reset();
+      updateEquations();
 
     // create a private copy for worker thread use
     vector<double> stockVarsCopy(stockVars);
-    volatile bool threadFinished=false;
     int err=GSL_SUCCESS;
-    // run RK algorithm on a separate worker thread so as to no block UI. See ticket #6
-    thread rkThread([&](){
+    auto integrate=[&](){
         if (ode)
           {
             gsl_odeiv2_driver_set_nmax(ode->driver, nSteps);
@@ -670,7 +916,8 @@ namespace minsky
           }
         else // do explicit Euler method
           {
-            vector<double> d(stockVarsCopy.size());
+            auto& d=workspace.d;
+            d.resize(stockVarsCopy.size());
             for (int i=0; i<nSteps; ++i, t+=stepMax)
               {
                 evalEquations(&d[0], t, &stockVarsCopy[0]);
@@ -678,16 +925,35 @@ namespace minsky
                   stockVarsCopy[j]+=d[j];
               }
           }
-        threadFinished=true;
-      });
+      };
 
-    while (!threadFinished)
+    if (threadedStep)
       {
-        // while waiting for thread to finish, check and process any UI events
-        usleep(1000);
-        doOneEvent();
+        volatile bool threadFinished=false;
+        // simulation state is thread local, so the worker is handed
+        // a copy of this thread's
+        auto& callerFlowVars=flowVars;
+        auto& callerStockVars=stockVars;
+        // run RK algorithm on a separate worker thread so as to no block UI. See ticket #6
+        thread rkThread([&](){
+            LocalMinsky lm(*this);
+            flowVars=callerFlowVars;
+            stockVars=callerStockVars;
+            integrate();
+            threadFinished=true;
+          });
+
+        while (!threadFinished)
+          {
+            // while waiting for thread to finish, check and process any UI events
+            usleep(1000);
+            doOneEvent();
+          }
+        rkThread.join();
       }
-    rkThread.join();
+    else
+      integrate();
+    EvalOpBase::t=t;
     
     switch (err)
       {
@@ -711,7 +977,24 @@ namespace minsky
     model->recursiveDo
       (&Group::items, 
        [&](Items&, Items::iterator i) 
-       {(*i)->updateIcon(t); return false;});
+       {
+         (*i)->updateIcon(t);
+         if ((*i)->dynamicAppearance())
+           {
+             auto& c=(*i)->renderCache;
+             double v=(*i)->appearanceValue();
+             if (!(v==c.value)) // NaN compares unequal
+               {
+                 c.value=v;
+                 c.dirty=true;
+                 // groups display their I/O variables' values
+                 if ((*i)->ioVar())
+                   if (auto g=(*i)->group.lock())
+                     g->renderCache.dirty=true;
+               }
+           }
+         return false;
+       });
 
     // throttle redraws
     time_duration maxWait=milliseconds(maxWaitMS);
@@ -743,9 +1026,9 @@ namespace minsky
     EvalOpBase::t=t;
     // firstly evaluate the flow variables. Initialise to flowVars so
     // that no input vars are correctly initialised
-    vector<double> flow(flowVars);
-    for (size_t i=0; i<equations.size(); ++i)
-      equations[i]->eval(&flow[0], vars);
+    auto& flow=workspace.flow;
+    flow.assign(flowVars.begin(), flowVars.end());
+    compiledEquations.eval(&flow[0], vars);
 
     // then create the result using the Godley table
     for (size_t i=0; i<stockVars.size(); ++i) result[i]=0;
@@ -763,23 +1046,108 @@ namespace minsky
       }
   }
 
+  void Minsky::computeJacobianSparsity()
+  {
+    auto& js=jacobianSparsity;
+    js.size=stockVars.size();
+    js.rows.assign(js.size, vector<unsigned>());
+    js.colours.clear();
+
+    // set of stock variables each flow variable depends on
+    vector<vector<unsigned>> flowDeps(flowVars.size());
+    vector<unsigned> tmp;
+    auto deps=[&](unsigned idx, bool flow)->vector<unsigned> {
+      if (flow) return flowDeps[idx];
+      return vector<unsigned>{idx};
+    };
+    for (auto& e: equations)
+      for (size_t i=0; i<(e->numArgs()? e->in1.size(): 1); ++i)
+        {
+          tmp.clear();
+          if (e->numArgs()>0)
+            {
+              auto d1=deps(e->in1[i],e->flow1);
+              if (e->numArgs()>1)
+                {
+                  auto d2=deps(e->in2[i],e->flow2);
+                  set_union(d1.begin(),d1.end(),d2.begin(),d2.end(),back_inserter(tmp));
+                }
+              else
+                tmp.swap(d1);
+            }
+          flowDeps[e->out+i]=tmp;
+        }
+
+    // stock variable derivatives each stock variable depends on
+    vector<set<unsigned>> rowDeps(js.size);
+    evalGodley.forAllElements([&](int s, int f) {
+        rowDeps[s].insert(flowDeps[f].begin(), flowDeps[f].end());
+      });
+    for (auto& i: integrals)
+      if (i.stock.idx()>=0 && i.input.idx()>=0)
+        {
+          auto d=deps(i.input.idx(), i.input.isFlowVar());
+          rowDeps[i.stock.idx()]=set<unsigned>(d.begin(), d.end());
+        }
+    for (size_t i=0; i<rowDeps.size(); ++i)
+      for (auto j: rowDeps[i])
+        js.rows[j].push_back(i);
+
+    // greedily colour columns, so no two columns of the same colour
+    // share a nonzero row
+    vector<vector<bool>> rowUsed;
+    for (unsigned j=0; j<js.size; ++j)
+      {
+        size_t c=0;
+        for (; c<js.colours.size(); ++c)
+          {
+            bool conflict=false;
+            for (auto i: js.rows[j])
+              conflict|=rowUsed[c][i];
+            if (!conflict) break;
+          }
+        if (c==js.colours.size())
+          {
+            js.colours.emplace_back();
+            rowUsed.emplace_back(js.size, false);
+          }
+        js.colours[c].push_back(j);
+        for (auto i: js.rows[j])
+          rowUsed[c][i]=true;
+      }
+  }
+
   void Minsky::jacobian(Matrix& jac, double t, const double sv[])
   {
     EvalOpBase::t=t;
     // firstly evaluate the flow variables. Initialise to flowVars so
     // that no input vars are correctly initialised
-    vector<double> flow=flowVars;
-    for (size_t i=0; i<equations.size(); ++i)
-      equations[i]->eval(&flow[0], sv);
-
-    // then determine the derivatives with respect to variable j
-    for (size_t j=0; j<stockVars.size(); ++j)
+    auto& flow=workspace.jacFlow;
+    flow.assign(flowVars.begin(), flowVars.end());
+    compiledEquations.eval(&flow[0], sv);
+
+    if (jacobianSparsity.size!=stockVars.size())
+      computeJacobianSparsity();
+
+    for (size_t i=0; i<stockVars.size(); i++)
+      for (size_t j=0; j<stockVars.size(); j++)
+        jac(i,j)=0;
+
+    auto& ds=workspace.ds;
+    auto& df=workspace.df;
+    auto& d=workspace.d;
+    // then determine the derivatives with respect to all variables
+    // of a colour simultaneously. As columns of a colour share no
+    // nonzero row, each row of the result belongs to a unique column
+    for (auto& colour: jacobianSparsity.colours)
       {
-        vector<double> ds(stockVars.size()), df(flowVars.size());
-        ds[j]=1;
+        ds.assign(stockVars.size(), 0);
+        df.assign(flowVars.size(), 0);
+        for (auto j: colour)
+          ds[j]=1;
         for (size_t i=0; i<equations.size(); ++i)
           equations[i]->deriv(&df[0], &ds[0], sv, &flow[0]);
-        vector<double> d(stockVars.size());
+        d.assign(stockVars.size(), 0);
         evalGodley.eval(&d[0], &df[0]);
         for (vector<Integral>::iterator i=integrals.begin(); 
              i!=integrals.end(); ++i)
@@ -788,12 +1156,119 @@ namespace minsky
             d[i->stock.idx()] = 
               i->input.isFlowVar()? df[i->input.idx()]: ds[i->input.idx()];
           }
-        for (size_t i=0; i<stockVars.size(); i++)
-          jac(i,j)=d[i];
+        for (auto j: colour)
+          for (auto i: jacobianSparsity.rows[j])
+            jac(i,j)=d[i];
       }
   
   }
 
+  namespace
+  {
+    /*
+      Binary .mky files consist of
+
+        magic number "MINSKYB1"
+        uint32 schema version
+        uint64 fingerprint of the schema's layout
+        uint32 format flags
+        uint64 size of the packed schema
+        uint64 size of the payload
+
+      followed by the payload, which is a schema2::Minsky packed with
+      classdesc::pack_t, zlib compressed if the compressedPayload flag
+      is set. All quantities are in native byte order.
+    */
+    const char binaryMagic[]="MINSKYB1";
+    const size_t binaryMagicLen=sizeof(binaryMagic)-1;
+    enum BinaryFormatFlags {compressedPayload=1};
+
+    /// hash of the XML schema of schema2::Minsky, which changes
+    /// whenever the layout of its packed form does
+    uint64_t computeFingerprint()
+    {
+      xsd_generate_t x;
+      xsd_generate(x,"Minsky",schema2::Minsky());
+      ostringstream xsd;
+      x.output(xsd,schemaURL);
+      // FNV-1a
+      uint64_t fingerprint=14695981039346656037ULL;
+      for (unsigned char c: xsd.str())
+        fingerprint=(fingerprint^c)*1099511628211ULL;
+      return fingerprint;
+    }
+
+    uint64_t schemaFingerprint()
+    {
+      // initialised once, thread safely, as parameter sweeps load
+      // models concurrently
+      static const uint64_t fingerprint=computeFingerprint();
+      return fingerprint;
+    }
+
+    bool isBinaryFile(const string& filename)
+    {
+      ifstream f(filename, ios::binary);
+      char m[binaryMagicLen];
+      return f.read(m, binaryMagicLen) && memcmp(m, binaryMagic, binaryMagicLen)==0;
+    }
+
+    template <class T> void writePOD(ostream& o, T x)
+    {o.write(reinterpret_cast<const char*>(&x), sizeof(x));}
+
+    template <class T> void readPOD(istream& i, T& x)
+    {
+      i.read(reinterpret_cast<char*>(&x), sizeof(x));
+      if (!i) throw runtime_error("truncated binary model file");
+    }
+
+    void readBinary(const string& filename, schema2::Minsky& m)
+    {
+      ifstream f(filename, ios::binary);
+      f.ignore(binaryMagicLen);
+      uint32_t version, format;
+      uint64_t fingerprint, size, payloadSize;
+      readPOD(f, version);
+      readPOD(f, fingerprint);
+      readPOD(f, format);
+      readPOD(f, size);
+      readPOD(f, payloadSize);
+      if (version!=uint32_t(schema2::Minsky::version))
+        throw runtime_error("binary Minsky schema version "+to_string(version)+" not supported");
+      if (fingerprint!=schemaFingerprint())
+        throw runtime_error(filename+" was saved by a different release of Minsky, which should be used to save it as XML");
+
+      // validate the sizes before allocating anything, so that a
+      // corrupt header cannot request an arbitrarily large buffer
+      auto payloadStart=f.tellg();
+      f.seekg(0, ios::end);
+      uint64_t available=f.tellg()-payloadStart;
+      f.seekg(payloadStart);
+      if (!f || payloadSize>available)
+        throw runtime_error("truncated binary model file");
+      // zlib cannot compress by more than a factor of 1032
+      if ((format & compressedPayload)? size>1032*payloadSize+64: size!=payloadSize)
+        throw runtime_error("corrupt binary model file");
+
+      vector<char> payload(payloadSize);
+      f.read(payload.data(), payloadSize);
+      if (!f) throw runtime_error("truncated binary model file");
+      pack_t buf;
+      if (format & compressedPayload)
+        {
+          vector<char> packed(size);
+          uLongf n=size;
+          if (uncompress(reinterpret_cast<Bytef*>(packed.data()), &n,
+                         reinterpret_cast<const Bytef*>(payload.data()), payloadSize)!=Z_OK || n!=size)
+            throw runtime_error("corrupt binary model file");
+          buf.packraw(packed.data(), size);
+        }
+      else
+        buf.packraw(payload.data(), payloadSize);
+      buf>>m;
+    }
+  }
+
   void Minsky::save(const std::string& filename)
   {
     ofstream of(filename);
@@ -807,6 +1282,40 @@ namespace minsky
     flags &= ~is_edited;
   }
 
+  void Minsky::saveBinary(const std::string& filename, bool compressed)
+  {
+    schema2::Minsky m(*this);
+    pack_t buf;
+    buf<<m;
+    uint64_t size=buf.size();
+    uint32_t format=0;
+    const char* payload=buf.data();
+    uLongf payloadSize=size;
+    vector<Bytef> compressedBuf;
+    if (compressed)
+      {
+        payloadSize=compressBound(size);
+        compressedBuf.resize(payloadSize);
+        if (compress2(compressedBuf.data(), &payloadSize,
+                      reinterpret_cast<const Bytef*>(buf.data()), size, Z_BEST_SPEED)!=Z_OK)
+          throw runtime_error("failed to compress "+filename);
+        payload=reinterpret_cast<const char*>(compressedBuf.data());
+        format|=compressedPayload;
+      }
+
+    ofstream of(filename, ios::binary);
+    of.write(binaryMagic, binaryMagicLen);
+    writePOD(of, uint32_t(schema2::Minsky::version));
+    writePOD(of, schemaFingerprint());
+    writePOD(of, format);
+    writePOD(of, size);
+    writePOD(of, uint64_t(payloadSize));
+    of.write(payload, payloadSize);
+    if (!of)
+      throw runtime_error("cannot save to "+filename);
+    flags &= ~is_edited;
+  }
+
 
   void Minsky::load(const std::string& filename) 
   {
@@ -815,38 +1324,56 @@ namespace minsky
 
     // current schema
     schema2::Minsky currentSchema;
-    ifstream inf(filename);
-    if (!inf)
-      throw runtime_error("failed to open "+filename);
-    xml_unpack_t saveFile(inf);
-    xml_unpack(saveFile, "Minsky", currentSchema);
-
-    switch (currentSchema.schemaVersion)
+    if (isBinaryFile(filename))
       {
-      case 0:
-        {
-          schema0::Minsky schema0;
-          xml_unpack(saveFile, "root", schema0);
-          schema1::Minsky schema1(schema0);
-          // fix corruption caused by ticket #329
-          schema1.removeIntVarOrphans();
-          *this=schema2::Minsky(schema1);
-          break;
-        }
-      case 1:
-        {
-          schema1::Minsky schema1;
-          xml_unpack(saveFile, "Minsky", schema1);
-          // fix corruption caused by ticket #329
-          schema1.removeIntVarOrphans();
-          *this=schema2::Minsky(schema1);
-          break;
-        }
-      case 2:
+        readBinary(filename, currentSchema);
         *this = currentSchema;
-        break;
-      default:
-        throw error("Minsky schema version %d not supported",currentSchema.schemaVersion);
+      }
+    else
+      {
+        ifstream inf(filename);
+        if (!inf)
+          throw runtime_error("failed to open "+filename);
+        // current schema files are loaded incrementally, older ones
+        // via the full document
+        Minsky m;
+        if (schema2::Minsky::streamLoad(inf, m, [this](double f){loadProgress(f);}))
+          *this=m;
+        else
+          {
+            inf.clear();
+            inf.seekg(0);
+            xml_unpack_t saveFile(inf);
+            xml_unpack(saveFile, "Minsky", currentSchema);
+
+            switch (currentSchema.schemaVersion)
+              {
+              case 0:
+                {
+                  schema0::Minsky schema0;
+                  xml_unpack(saveFile, "root", schema0);
+                  schema1::Minsky schema1(schema0);
+                  // fix corruption caused by ticket #329
+                  schema1.removeIntVarOrphans();
+                  *this=schema2::Minsky(schema1);
+                  break;
+                }
+              case 1:
+                {
+                  schema1::Minsky schema1;
+                  xml_unpack(saveFile, "Minsky", schema1);
+                  // fix corruption caused by ticket #329
+                  schema1.removeIntVarOrphans();
+                  *this=schema2::Minsky(schema1);
+                  break;
+                }
+              case 2:
+                *this = currentSchema;
+                break;
+              default:
+                throw error("Minsky schema version %d not supported",currentSchema.schemaVersion);
+              }
+          }
       }
 
     // try balancing all Godley tables
@@ -1072,44 +1599,21 @@ namespace minsky
     // go via a schema object, as serialising minsky::Minsky has
     // problems due to port management
     schema2::Minsky m(*this);
+    // the canonical form packs to the same bytes whenever the saved
+    // model would be the same, so DeltaHistory::push's byte
+    // comparison detects whether anything has changed
+    m.canonicalise();
     pack_t buf;
     buf<<m;
-    if (history.empty())
-      {
-        history.emplace_back();
-        buf.swap(history.back());
-        historyPtr=history.size();
-        return true;
-      }
-    while (history.size()>maxHistory)
-      history.pop_front();
-    if (memcmp(buf.data(), history.back().data(), buf.size())!=0)
-      {
-        // check XML versions differ (slower)
-        ostringstream prev, curr;
-        xml_pack_t prevXbuf(prev), currXbuf(curr);
-        xml_pack(currXbuf,"Minsky",m);
-        history.back().reseto()>>m;
-        xml_pack(prevXbuf,"Minsky",m);
-
-        if (curr.str()!=prev.str())
-          {
-            // This bit of code outputs an XML representation that can be
-            //        used for debugging issues related to unnecessary
-            //        history pushes.
-            //  buf.reseto()>>m;
-            //  xml_pack_t tb(cout);
-            //  tb.prettyPrint=true;
-            //  xml_pack(tb,"Minsky",m); 
-            //  cout<<"------"<<endl;
-            history.emplace_back();
-            buf.swap(history.back());
-            historyPtr=history.size();
-            return true;
-          }
-      }
+    if (history.size()>maxHistory)
+      history.truncate(maxHistory);
+    bool pushed=history.push(buf.data(), buf.size());
     historyPtr=history.size();
-    return false;
+    // called after every command, so only discard cached renderings
+    // when the model has actually changed
+    if (pushed)
+      canvas.invalidateRenderCache();
+    return pushed;
   }
 
   void Minsky::undo(int changes)
@@ -1120,8 +1624,12 @@ namespace minsky
     historyPtr-=changes;
     if (historyPtr > 0 && historyPtr <= history.size())
       {
+        vector<char> state;
+        history.get(historyPtr-1, state);
+        pack_t buf;
+        buf.packraw(state.data(), state.size());
         schema2::Minsky m;
-        history[historyPtr-1].reseto()>>m;
+        buf>>m;
         clearAllMaps();
         model->clear();
         m.populateGroup(*model);
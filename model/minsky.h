@@ -26,7 +26,9 @@
 #include "godleyIcon.h"
 #include "operation.h"
 #include "evalOp.h"
+#include "evalProgram.h"
 #include "evalGodley.h"
+#include "variableLog.h"
 #include "wire.h"
 #include "plotWidget.h"
 #include "version.h"
@@ -37,6 +39,7 @@
 #include "variableValue.h"
 #include "canvas.h"
 #include "panopticon.h"
+#include "deltaHistory.h"
 #include "rungeKutta.h"
 
 #include <vector>
@@ -84,17 +87,60 @@ namespace minsky
     void requestRedraw() {if (surface.get()) surface->requestRedraw();}
   };
   
+  /// preallocated working storage for evalEquations() and
+  /// jacobian(), so that no heap allocation occurs once sized
+  struct EvalWorkspace
+  {
+    vector<double> flow; ///< flow variables, for evalEquations
+    vector<double> jacFlow, ds, df, d; ///< for jacobian
+    /// size workspace for a system of \a nStocks stock variables and
+    /// \a nFlows flow variables
+    void resize(size_t nStocks, size_t nFlows) {
+      flow.reserve(nFlows); jacFlow.reserve(nFlows); df.reserve(nFlows);
+      ds.reserve(nStocks); d.reserve(nStocks);
+    }
+  };
+
+  /// structural nonzeros of the Jacobian, with the columns partitioned
+  /// into colours sharing no nonzero row, so that all columns of a
+  /// colour can be evaluated in a single derivative sweep
+  struct JacobianSparsity
+  {
+    size_t size=0; ///< number of stock variables
+    vector<vector<unsigned>> rows; ///< nonzero rows of each column
+    vector<vector<unsigned>> colours; ///< columns of each colour
+  };
+
   // a place to put working variables of the Minsky class that needn't
   // be serialised.
   struct MinskyExclude
   {
     EvalOpVector equations;
+    /// equations compiled into a flat instruction stream
+    EvalProgram compiledEquations;
+    EvalWorkspace workspace;
+    JacobianSparsity jacobianSparsity;
     vector<Integral> integrals;
     shared_ptr<RKdata> ode;
-    shared_ptr<ofstream> outputDataFile;
+    shared_ptr<VariableLog> outputDataFile;
+    /// valueIds of the logged variables, and their values, resolved
+    /// when the log file is opened
+    std::vector<std::string> loggedIds;
+    std::vector<const VariableValue*> loggedValues;
+    /// file the log is being written to, and the CSV file it is to
+    /// be converted to when closed, if any
+    std::string binaryLogName, csvLogName;
+    /// structural signature of the model the current equations were
+    /// constructed from. See Minsky::structuralSignature()
+    uint64_t equationSignature=0;
     
     enum StateFlags {is_edited=1, reset_needed=2};
     int flags=reset_needed;
+
+    /// if true, step() integrates on a worker thread, processing GUI
+    /// events whilst waiting. Otherwise, integration is performed
+    /// directly on the calling thread (eg in batch mode)
+    bool threadedStep=true;
     
     std::vector<int> flagStack;
 
@@ -106,13 +152,8 @@ namespace minsky
     MinskyExclude(const MinskyExclude&): historyPtr(0) {}
     MinskyExclude& operator=(const MinskyExclude&) {return *this;}
   protected:
-    /// save history of model for undo
-    /* 
-       TODO: it should be sufficient to add move semantics to pack_t,
-       but for some reason copy semantics are required, requiring the
-       use of shared_ptr
-     */
-    std::deque<classdesc::pack_t> history;
+    /// save history of model for undo, as serialised schema2::Minsky objects
+    DeltaHistory history;
     size_t historyPtr;
     
   };
@@ -141,6 +182,15 @@ namespace minsky
 
     /// write current state of all variables to the log file
     void logVariables() const;
+    /// (re)establish loggedValues from loggedIds
+    void resolveLoggedValues();
+    /// set up the integrator and associated state once the equations
+    /// have been constructed
+    void initSimulation();
+
+    /// compute jacobianSparsity from the dependency graph of equations,
+    /// evalGodley and integrals
+    void computeJacobianSparsity();
 
     Exclude<boost::posix_time::ptime> lastRedraw;
 
@@ -156,6 +206,7 @@ namespace minsky
     void markEdited() {
       flags |= is_edited | reset_needed;
       canvas.model.updateTimestamp();
+      canvas.invalidateRenderCache();
     }
 
     /// @{ push and pop state of the flags
@@ -171,8 +222,7 @@ namespace minsky
     /// evaluate the flow equations without stepping.
     /// @throw ecolab::error if equations are illdefined
     void evalEquations() {
-      for (auto& eq: equations)
-        eq->eval(&flowVars[0], &stockVars[0]);
+      compiledEquations.eval(&flowVars[0], &stockVars[0]);
     }
     
     VariableValues variableValues;
@@ -251,6 +301,10 @@ namespace minsky
     virtual std::string getClipboard() const {return "";}
     /// @}
 
+    /// override to display the progress of load(), as the fraction of
+    /// the file read so far
+    virtual void loadProgress(double) {}
+
     /// toggle selected status of given item
     void toggleSelected(ItemType itemType, int item);
 
@@ -265,11 +319,14 @@ namespace minsky
     /// if there are some
     bool cycleCheck() const;
 
-    /// opens the log file, and writes out a header line describing
-    /// names of all variables
-    void openLogFile(const string&);
-    /// closes log file
-    void closeLogFile() {outputDataFile.reset();}
+    /// opens the log file, and writes out a header describing names
+    /// and units of the variables in logVarList. See variableLog.h
+    /// for the file format. Unless \a name has the extension .mlog,
+    /// the log is written to a temporary file, and converted to CSV
+    /// in \a name by closeLogFile()
+    void openLogFile(const string& name);
+    /// closes log file, converting it to CSV if requested
+    void closeLogFile();
     std::set<string> logVarList;
     
     /// construct the equations based on input data
@@ -290,11 +347,23 @@ namespace minsky
     double t0{0}; ///< simulation start time
     string timeUnit;
     void reset(); ///<resets the variables back to their initial values
+    /// bring the equations up to date with any edits made since they
+    /// were constructed. Equations are only reconstructed if the
+    /// structure of the model has changed, and once the simulation
+    /// has started, stock variable values and time are preserved
+    /// rather than reset.
+    void updateEquations();
+    /// hash of the attributes of the model affecting the equations,
+    /// omitting layout, and initial values of parameters and stocks
+    uint64_t structuralSignature() const;
     void step();  ///< step the equations (by n steps, default 1)
 
     /// save to a file
     void save(const std::string& filename);
-    /// load from a file
+    /// save to a file in binary format, which loads faster than XML,
+    /// but is specific to this version of the schema and platform
+    void saveBinary(const std::string& filename, bool compressed=true);
+    /// load from a file, in either XML or binary format
     void load(const std::string& filename);
 
     void exportSchema(const char* filename, int schemaLevel=1);
@@ -363,11 +432,15 @@ namespace minsky
     
   };
 
-  /// global minsky object
+  /// global minsky object, which is the one set by LocalMinsky on
+  /// the current thread, if any, otherwise globalMinsky()
   Minsky& minsky();
+  /// the application's Minsky object, defined by each executable
+  Minsky& globalMinsky();
   /// const version to help in const correctness
   inline const Minsky& cminsky() {return minsky();}
-  /// RAII set the minsky object to a different one for the current scope.
+  /// RAII set the minsky object to a different one for the current
+  /// scope, on the current thread.
   struct LocalMinsky
   {
     LocalMinsky(Minsky& m);
@@ -386,6 +459,20 @@ namespace minsky
 #pragma omit xml_unpack minsky::MinskyExclude
 #pragma omit xsd_generate minsky::MinskyExclude
 
+#pragma omit pack minsky::EvalWorkspace
+#pragma omit unpack minsky::EvalWorkspace
+#pragma omit TCL_obj minsky::EvalWorkspace
+#pragma omit xml_pack minsky::EvalWorkspace
+#pragma omit xml_unpack minsky::EvalWorkspace
+#pragma omit xsd_generate minsky::EvalWorkspace
+
+#pragma omit pack minsky::JacobianSparsity
+#pragma omit unpack minsky::JacobianSparsity
+#pragma omit TCL_obj minsky::JacobianSparsity
+#pragma omit xml_pack minsky::JacobianSparsity
+#pragma omit xml_unpack minsky::JacobianSparsity
+#pragma omit xsd_generate minsky::JacobianSparsity
+
 #pragma omit xml_pack minsky::Integral
 #pragma omit xml_unpack minsky::Integral
 
@@ -26,6 +26,7 @@
 #include <cairo_base.h>
 #include <pango.h>
 #include <ecolab_epilogue.h>
+#include <boost/functional/hash.hpp>
 
 #include <math.h>
 #include <sstream>
@@ -259,7 +260,7 @@ namespace minsky
           cairo_stroke(cairo);
         
           VariablePtr intVar=i->intVar;
-          intVar->zoomFactor=zoomFactor;
+          setGeometry(*intVar,intVar->zoomFactor,zoomFactor);
           // display an integration variable next to it
           RenderVariable rv(*intVar, cairo);
           // save the render width for later use in setting the clip
@@ -385,6 +386,18 @@ namespace minsky
       g->removeItem(*intVar);
   }
 
+  size_t IntOp::displayHash() const
+  {
+    auto h=Item::displayHash();
+    if (intVar)
+      {
+        // the integration variable is drawn as part of the icon
+        boost::hash_combine(h, intVar->displayHash());
+        boost::hash_combine(h, coupled());
+      }
+    return h;
+  }
+
   void IntOp::description_(string desc)
   {
 
@@ -518,14 +531,10 @@ namespace minsky
 
   void DataOp::readData(const string& fileName)
   {
-    ifstream f(fileName.c_str());
-    data.clear();
-    // for now, we just read pairs of numbers, separated by
-    // whitespace. Later, we need to add in the smarts to handle a
-    // variety of CSV formats
-    double x, y;
-    while (f>>x>>y)
-      data[x]=y; // TODO: throw if more than one equal value of x provided?
+    if (DataSeries::isBinaryFile(fileName))
+      data.readBinary(fileName);
+    else
+      data.readText(fileName);
 
     // trim any leading directory
     size_t p=fileName.rfind('/');
@@ -538,52 +547,27 @@ namespace minsky
   void DataOp::initRandom(double xmin, double xmax, unsigned numSamples)
   {
     srand(::time(nullptr));
-    data.clear();
+    vector<double> x, y;
     double dx=(xmax-xmin)/numSamples;
-    for (double x=xmin; x<xmax; x+=dx)
-      data[x]=double(rand())/RAND_MAX;
-  }
-
-  
-  double DataOp::interpolate(double x) const
-  {
-    // not terribly sensible, but need to return something
-    if (data.empty()) return 0;
-
-    map<double, double>::const_iterator v=data.lower_bound(x);
-    if (v==data.end())
-      return data.rbegin()->second;
-    else if (v==data.begin())
-      return v->second;
-    else if (v->first > x)
-      {
-        map<double, double>::const_iterator v0=v;
-        --v0;
-        return (x-v0->first)*(v->second-v0->second)/
-          (v->first-v0->first)+v0->second;
-      }
-    else
+    for (double xi=xmin; xi<xmax; xi+=dx)
       {
-        assert(v->first==x);
-        return v->second;
+        x.push_back(xi);
+        y.push_back(double(rand())/RAND_MAX);
       }
+    data.assign(move(x), move(y));
   }
 
+  double DataOp::interpolate(double x) const
+  {return data.interpolate(x, cursor);}
+
   double DataOp::deriv(double x) const
+  {return data.deriv(x, cursor);}
+
+  size_t DataOp::displayHash() const
   {
-    map<double, double>::const_iterator v=data.lower_bound(x);
-    if (v==data.end() || v==data.begin())
-      return 0;
-    map<double, double>::const_iterator v1=v, v2=v; 
-    --v1;
-    if (v->first==x)
-      {
-        ++v2;
-        if (v2==data.end()) v2=v;
-        return (v2->second-v1->second)/(v2->first-v1->first);
-      }
-    else 
-      return (v->second-v1->second)/(v->first-v1->first);
+    auto h=Item::displayHash();
+    boost::hash_combine(h, description);
+    return h;
   }
 
   void DataOp::initOutputVariableValue(VariableValue& v) const
@@ -592,11 +576,11 @@ namespace minsky
     if (xVector.size())
       v.xVector=xVector;
     auto iy=v.begin();
-    for (auto& j: data)
+    for (size_t j=0; j<data.size(); ++j)
       {
         if (xVector.empty())
-          v.xVector.emplace_back(j.first,to_string(j.first));
-        *iy++=j.second;
+          v.xVector.emplace_back(data.x()[j],to_string(data.x()[j]));
+        *iy++=data.y()[j];
       }
   }
 
@@ -29,6 +29,7 @@
 #include "item.h"
 #include "variable.h"
 #include "slider.h"
+#include "dataSeries.h"
 
 #include <vector>
 #include <cairo/cairo.h>
@@ -77,6 +78,8 @@ namespace minsky
     virtual void addPorts();
 
     void draw(cairo_t*) const override;
+    /// port values are only displayed on mouseover
+    bool dynamicAppearance() const override {return false;}
 
     /// current value of output port
     double value() const override;
@@ -148,6 +151,11 @@ namespace minsky
     VariablePtr intVar; 
 
     bool handleArrows(int dir) override {return intVar->handleArrows(dir);}
+    /// displays the integration variable's value when coupled
+    bool dynamicAppearance() const override {return true;}
+    double appearanceValue() const override
+    {return intVar? intVar->appearanceValue(): 0;}
+    size_t displayHash() const override;
 
     /// toggles coupled state of integration variable. Only valid for integrate
     /// @return coupled state
@@ -164,10 +172,17 @@ namespace minsky
   class DataOp: public NamedOp, public ItemT<DataOp, Operation<minsky::OperationType::data>>
   {
     CLASSDESC_ACCESS(DataOp);
+    /// lookup position of the previous interpolate or deriv call
+    mutable classdesc::Exclude<DataSeries::Cursor> cursor;
   public:
-    std::map<double, double> data;
+    DataSeries data;
     std::vector<std::pair<double, std::string>> xVector;
+    /// read data from \a fileName, either in the binary format
+    /// written by writeBinaryData, or as text (see DataSeries::readText)
     void readData(const string& fileName);
+    /// save data in a binary format, which readData loads much
+    /// faster than text
+    void writeBinaryData(const string& fileName) const {data.writeBinary(fileName);}
     /// initialise with uniform random numbers 
     void initRandom(double xmin, double xmax, unsigned numSamples);
     /// interpolates y data between x values bounding the argument
@@ -179,6 +194,7 @@ namespace minsky
 
     /// called to initialise a variable value when no input wire is connected
     void initOutputVariableValue(VariableValue&) const;
+    size_t displayHash() const override;
     
     void pack(pack_t& x, const string& d) const override;
     void unpack(unpack_t& x, const string& d) override;
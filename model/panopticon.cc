@@ -18,44 +18,253 @@
 */
 
 #include "panopticon.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "ecolab_epilogue.h"
 using namespace minsky;
+using namespace std;
+
+namespace minsky
+{
+  /// renders snapshots on a worker thread. Only the most recently
+  /// submitted snapshot is rendered.
+  class PanopticonRenderer
+  {
+  public:
+    /// geometry of a model, in unzoomed model coordinates
+    struct Snapshot
+    {
+      struct Box
+      {
+        float x0, y0, x1, y1;
+        bool group;
+      };
+      std::vector<Box> boxes;
+      std::vector<std::vector<float>> wires;
+      double left=0, top=0, width=0, height=0;
+      /// resolution to render at
+      int pixelWidth=0, pixelHeight=0;
+    };
+
+    struct Thumbnail
+    {
+      std::shared_ptr<cairo_surface_t> image;
+      double left=0, top=0, width=0, height=0, scale=1;
+    };
+
+    PanopticonRenderer(): worker([this](){run();}) {}
+    ~PanopticonRenderer()
+    {
+      {
+        lock_guard<mutex> lock(m);
+        finished=true;
+      }
+      cv.notify_all();
+      worker.join();
+    }
+
+    void submit(std::unique_ptr<Snapshot>&& s)
+    {
+      {
+        lock_guard<mutex> lock(m);
+        pending=move(s);
+      }
+      cv.notify_all();
+    }
+
+    bool ready() const
+    {
+      lock_guard<mutex> lock(m);
+      return haveResult;
+    }
+
+    /// true if a snapshot is awaiting or undergoing rendering, or
+    /// its thumbnail has not been taken
+    bool busy() const
+    {
+      lock_guard<mutex> lock(m);
+      return pending || rendering || haveResult;
+    }
+
+    /// retrieve the latest thumbnail, if any
+    bool take(Thumbnail& t)
+    {
+      lock_guard<mutex> lock(m);
+      if (!haveResult) return false;
+      t=move(result);
+      haveResult=false;
+      return true;
+    }
+
+  private:
+    mutable mutex m;
+    condition_variable cv;
+    std::unique_ptr<Snapshot> pending;
+    Thumbnail result;
+    bool haveResult=false, rendering=false, finished=false;
+    std::thread worker; // started once the above are initialised
+
+    /// draw items as boxes, and wires as lines
+    static Thumbnail render(const Snapshot& s)
+    {
+      Thumbnail r;
+      r.left=s.left; r.top=s.top; r.width=s.width; r.height=s.height;
+      r.scale=min(s.pixelWidth/s.width, s.pixelHeight/s.height);
+      r.image.reset(cairo_image_surface_create
+                    (CAIRO_FORMAT_RGB24, max(1,int(r.scale*s.width)), max(1,int(r.scale*s.height))),
+                    cairo_surface_destroy);
+      auto cairo=cairo_create(r.image.get());
+      cairo_set_source_rgb(cairo,1,1,1);
+      cairo_paint(cairo);
+      cairo_scale(cairo,r.scale,r.scale);
+      cairo_translate(cairo,-s.left,-s.top);
+      cairo_set_line_width(cairo,1/r.scale);
+
+      for (auto& b: s.boxes)
+        {
+          cairo_rectangle(cairo,b.x0,b.y0,b.x1-b.x0,b.y1-b.y0);
+          if (b.group)
+            cairo_set_source_rgb(cairo,0.5,0.5,0.5);
+          else
+            {
+              cairo_set_source_rgb(cairo,0.8,0.8,0.8);
+              cairo_fill_preserve(cairo);
+              cairo_set_source_rgb(cairo,0,0,0);
+            }
+          cairo_stroke(cairo);
+        }
+
+      cairo_set_source_rgb(cairo,0,0,0);
+      for (auto& w: s.wires)
+        {
+          cairo_move_to(cairo,w[0],w[1]);
+          for (size_t i=2; i<w.size(); i+=2)
+            cairo_line_to(cairo,w[i],w[i+1]);
+          cairo_stroke(cairo);
+        }
+      cairo_destroy(cairo);
+      cairo_surface_flush(r.image.get());
+      return r;
+    }
+
+    void run()
+    {
+      unique_lock<mutex> lock(m);
+      for (;;)
+        {
+          cv.wait(lock, [this](){return pending || finished;});
+          if (finished) return;
+          auto s=move(pending);
+          rendering=true;
+          lock.unlock();
+          auto t=render(*s);
+          lock.lock();
+          result=move(t);
+          haveResult=true;
+          rendering=false;
+        }
+    }
+  };
+}
+
+bool Panopticon::renderReady() const
+{
+  return renderer && renderer->ready();
+}
+
+bool Panopticon::renderPending() const
+{
+  return renderer && renderer->busy();
+}
 
 void Panopticon::redraw(int, int, int w, int h)
 {
-  // cache results of canvas image size
-  if (canvas.model.timestamp>lastBoundsCheck || !cachedImage.get())
+  if (!renderer)
+    renderer=make_shared<PanopticonRenderer>();
+
+  // snapshot the model's geometry when it has changed
+  if (canvas.model.timestamp>lastBoundsCheck || w!=renderedWidth || h!=renderedHeight)
     {
       lastBoundsCheck=Canvas::Timestamp::clock::now();
-      cachedImage.reset(new cairo::Surface
-                            (cairo_recording_surface_create(CAIRO_CONTENT_COLOR,nullptr)));
-      cachedImage.swap(canvas.surface);
-      // render at zoom=1, 0,0
+      renderedWidth=w;
+      renderedHeight=h;
+      std::unique_ptr<PanopticonRenderer::Snapshot> s(new PanopticonRenderer::Snapshot);
+      // map canvas coordinates to zoom=1, 0,0
       double zf=canvas.model->zoomFactor, x=canvas.model->x(), y=canvas.model->y();
-      canvas.model->zoom(x,y,1/zf);
-      canvas.model->moveTo(0,0);
-      canvas.redraw();
-      canvas.model->moveTo(x,y);
-      canvas.model->zoom(x,y,zf);
-      cachedImage.swap(canvas.surface);
-    }
-  
-  double xscale=w/cachedImage->width(), yscale=h/cachedImage->height();
-  double scale=min(xscale,yscale);
-//  cairo_rectangle(surface->cairo(),0,0,w,h);
-//  cairo_clip(surface->cairo());
-  cairo_scale(surface->cairo(),scale,scale);
-  //cout << "scale:"<<scale<<endl;
-  // Heuristic to not render when scale is too small for things to be visible
-  if (scale>0.03)
+      double l=numeric_limits<double>::max(), t=l, r=-l, b=-l;
+      auto extend=[&](float x0, float y0, float x1, float y1)
+        {
+          l=min<double>(l,x0); r=max<double>(r,x1);
+          t=min<double>(t,y0); b=max<double>(b,y1);
+        };
+      auto addBox=[&](const Item& i, bool group)
+        {
+          if (!i.visible()) return;
+          PanopticonRenderer::Snapshot::Box box{float((i.left()-x)/zf), float((i.bottom()-y)/zf),
+                            float((i.right()-x)/zf), float((i.top()-y)/zf), group};
+          extend(box.x0,box.y0,box.x1,box.y1);
+          s->boxes.push_back(box);
+        };
+      canvas.model->recursiveDo
+        (&GroupItems::items, [&](const Items&, Items::const_iterator i)
+         {addBox(**i,false); return false;});
+      canvas.model->recursiveDo
+        (&GroupItems::groups, [&](const Groups&, Groups::const_iterator i)
+         {addBox(**i,true); return false;});
+      canvas.model->recursiveDo
+        (&GroupItems::wires, [&](const Wires&, Wires::const_iterator i)
+         {
+           if (!(*i)->visible()) return false;
+           auto c=(*i)->coords();
+           if (c.size()<4) return false;
+           for (size_t j=0; j<c.size(); j+=2)
+             {
+               c[j]=(c[j]-x)/zf;
+               c[j+1]=(c[j+1]-y)/zf;
+               extend(c[j],c[j+1],c[j],c[j+1]);
+             }
+           s->wires.push_back(move(c));
+           return false;
+         });
+      if (r>=l)
+        {
+          s->left=l-1; s->top=t-1;
+          s->width=r-l+2; s->height=b-t+2;
+          s->pixelWidth=max(w,1);
+          s->pixelHeight=max(h,1);
+          renderer->submit(move(s));
+        }
+    }
+
+  PanopticonRenderer::Thumbnail thumbnail;
+  if (renderer->take(thumbnail))
     {
-      cairo_set_source_surface(surface->cairo(), cachedImage->surface(), -cachedImage->left(),-cachedImage->top());
-      cairo_paint(surface->cairo());
+      cachedImage=thumbnail.image;
+      imageLeft=thumbnail.left;
+      imageTop=thumbnail.top;
+      imageWidth=thumbnail.width;
+      imageHeight=thumbnail.height;
+      imageScale=thumbnail.scale;
     }
-  
+  if (!cachedImage.get())
+    {
+      surface->blit();
+      return;
+    }
+
+  double xscale=w/imageWidth, yscale=h/imageHeight;
+  double scale=min(xscale,yscale);
+  cairo_scale(surface->cairo(),scale,scale);
+  cairo_save(surface->cairo());
+  cairo_scale(surface->cairo(),1/imageScale,1/imageScale);
+  cairo_set_source_surface(surface->cairo(), cachedImage.get(), 0, 0);
+  cairo_paint(surface->cairo());
+  cairo_restore(surface->cairo());
+
   // draw indicator rectangle
   double zf=1/canvas.model->zoomFactor;
-  cairo_rectangle(surface->cairo(),-cachedImage->left()-canvas.model->x(),-cachedImage->top()-canvas.model->y(),zf*width,zf*height);
+  cairo_rectangle(surface->cairo(),-imageLeft-canvas.model->x(),-imageTop-canvas.model->y(),zf*width,zf*height);
   cairo_set_source_rgba(surface->cairo(),0,0,0,0.5);
   cairo_fill(surface->cairo());
   surface->blit();
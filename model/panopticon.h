@@ -24,18 +24,41 @@
 
 namespace minsky
 {
+  class PanopticonRenderer;
+
+  /**
+     Overview of the whole model. The thumbnail is rendered on a
+     worker thread from a snapshot of the model's geometry, drawing
+     items as boxes and wires as lines, so that redrawing the
+     panopticon never waits on a large model being rendered. A
+     completed thumbnail is displayed by the next redraw.
+  */
   struct Panopticon: public ecolab::CairoSurface
   {
+    CLASSDESC_ACCESS(Panopticon);
     double cleft=0, ctop=0, cwidth=0, cheight=0;
     Exclude<Canvas::Timestamp> lastBoundsCheck;
     double width=0,height=0;
     Canvas& canvas;
-    Exclude<cairo::SurfacePtr> cachedImage;
+    /// thumbnail currently displayed
+    Exclude<std::shared_ptr<cairo_surface_t>> cachedImage;
+    /// bounds of the model rendered into cachedImage, in unzoomed
+    /// model coordinates, and its resolution in pixels per unit
+    double imageLeft=0, imageTop=0, imageWidth=0, imageHeight=0, imageScale=1;
     Panopticon(Canvas& canvas): canvas(canvas)  {}
     void redraw(int, int, int width, int height) override;
     void requestRedraw() {if (surface.get()) surface->requestRedraw();}
+    /// true if a thumbnail has been rendered that has not yet been
+    /// displayed, for polling by the GUI
+    bool renderReady() const;
+    /// true if a thumbnail is being rendered, or has not yet been
+    /// displayed, so that the GUI need only poll while this is set
+    bool renderPending() const;
 
     Panopticon& operator=(const Panopticon&) {return *this;}
+  private:
+    Exclude<std::shared_ptr<PanopticonRenderer>> renderer;
+    int renderedWidth=0, renderedHeight=0; ///< size of the last thumbnail requested
   };
 }
 #include "panopticon.cd"
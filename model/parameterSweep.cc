@@ -0,0 +1,175 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "parameterSweep.h"
+#include "minsky.h"
+
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <ecolab_epilogue.h>
+using namespace std;
+
+namespace minsky
+{
+  namespace
+  {
+    // initial values are stored as strings, so retain full precision
+    string fullPrecision(double x)
+    {
+      ostringstream s;
+      s<<setprecision(17)<<x;
+      return s.str();
+    }
+  }
+
+  size_t ParameterSweep::numRuns() const
+  {
+    size_t r=samples;
+    for (auto& p: parameters)
+      if (p.distribution==SweepParameter::range)
+        r*=max(p.n,1U);
+    return r;
+  }
+
+  vector<double> ParameterSweep::parameterValues(size_t i) const
+  {
+    vector<double> r;
+    size_t gridPoint=i/max(samples,1U);
+    seed_seq seeds{uint32_t(seed), uint32_t(seed>>16>>16), uint32_t(i), uint32_t(i>>16>>16)};
+    mt19937 gen(seeds);
+    for (auto& p: parameters)
+      switch (p.distribution)
+        {
+        case SweepParameter::range:
+          {
+            unsigned n=max(p.n,1U), k=gridPoint%n;
+            gridPoint/=n;
+            r.push_back(n>1? p.a+(p.b-p.a)*k/(n-1): p.a);
+            break;
+          }
+        case SweepParameter::uniform:
+          r.push_back(uniform_real_distribution<double>(p.a,p.b)(gen));
+          break;
+        case SweepParameter::normal:
+          r.push_back(normal_distribution<double>(p.a,p.b)(gen));
+          break;
+        }
+    return r;
+  }
+
+  void ParameterSweep::run(const string& filename)
+  {
+    if (steps<0 && tmax==numeric_limits<double>::max())
+      throw runtime_error("parameter sweep requires a number of steps or a finishing time");
+
+    size_t n=numRuns();
+    results.assign(n, Run());
+    unsigned poolSize=nThreads? nThreads: max(thread::hardware_concurrency(),1U);
+    poolSize=min(size_t(poolSize), n);
+
+    atomic<size_t> nextRun(0);
+    atomic<bool> aborted(false);
+    exception_ptr fatal;
+    mutex fatalMutex;
+
+    // each worker simulates its own copy of the model, as simulation
+    // state is thread local
+    auto worker=[&]() {
+      try
+        {
+          Minsky m;
+          LocalMinsky lm(m);
+          m.threadedStep=false;
+          m.load(filename);
+          for (auto& p: parameters)
+            if (!m.variableValues.count(p.valueId))
+              throw runtime_error("unknown parameter "+p.valueId);
+          for (auto& o: outputs)
+            if (!m.variableValues.count(o))
+              throw runtime_error("unknown output "+o);
+
+          for (size_t i; !aborted && (i=nextRun++)<n; )
+            {
+              auto& run=results[i];
+              run.parameters=parameterValues(i);
+              try
+                {
+                  for (size_t j=0; j<parameters.size(); ++j)
+                    m.variableValues[parameters[j].valueId].init=
+                      fullPrecision(run.parameters[j]);
+                  m.reset();
+                  for (long s=0; (steps<0 || s<steps) && m.t<tmax; ++s)
+                    {
+                      double t=m.t;
+                      m.step();
+                      if (!(m.t>t))
+                        throw runtime_error("simulation time failed to advance at t="+to_string(t));
+                    }
+                  for (auto& o: outputs)
+                    run.outputs.push_back(m.variableValues[o].value());
+                }
+              catch (const std::exception& ex)
+                {
+                  run.error=ex.what();
+                  run.outputs.assign(outputs.size(), nan(""));
+                }
+              run.t=m.t;
+            }
+        }
+      catch (...)
+        {
+          lock_guard<mutex> lock(fatalMutex);
+          if (!fatal) fatal=current_exception();
+          aborted=true;
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned i=0; i<poolSize; ++i)
+      pool.emplace_back(worker);
+    for (auto& t: pool)
+      t.join();
+    if (fatal)
+      {
+        results.clear();
+        rethrow_exception(fatal);
+      }
+  }
+
+  void ParameterSweep::writeCSV(ostream& o) const
+  {
+    for (auto& p: parameters)
+      o<<p.valueId<<",";
+    for (auto& v: outputs)
+      o<<v<<",";
+    o<<"t\n";
+    for (auto& r: results)
+      {
+        for (auto x: r.parameters)
+          o<<fullPrecision(x)<<",";
+        for (auto x: r.outputs)
+          o<<fullPrecision(x)<<",";
+        o<<r.t<<"\n";
+      }
+  }
+}
@@ -0,0 +1,99 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace minsky
+{
+  /// a model parameter whose initial value is varied over a sweep
+  struct SweepParameter
+  {
+    enum Distribution {range, uniform, normal};
+    /// valueId of the variable varied
+    std::string valueId;
+    Distribution distribution=range;
+    /// lower and upper bounds for range and uniform parameters, mean
+    /// and standard deviation for normal ones
+    double a=0, b=0;
+    /// number of evenly spaced values taken by a range parameter
+    unsigned n=1;
+
+    SweepParameter() {}
+    SweepParameter(const std::string& valueId, Distribution distribution,
+                   double a, double b, unsigned n=1):
+      valueId(valueId), distribution(distribution), a(a), b(b), n(n) {}
+  };
+
+  /**
+     Simulates a model for each of a set of parameter values, with
+     each worker thread of a pool running its own Minsky instance.
+
+     The runs consist of the Cartesian product of all range
+     parameters, with each grid point repeated \a samples times, and
+     the random parameters drawn afresh for every run. Random draws
+     depend only on \a seed and the run number, so results are
+     reproducible regardless of the number of threads.
+  */
+  class ParameterSweep
+  {
+  public:
+    std::vector<SweepParameter> parameters;
+    /// valueIds of variables whose values are recorded at the end of each run
+    std::vector<std::string> outputs;
+    /// number of runs at each grid point
+    unsigned samples=1;
+    /// each run is stopped after \a steps calls to Minsky::step(), or
+    /// when simulation time reaches \a tmax, whichever occurs first
+    long steps=-1;
+    double tmax=std::numeric_limits<double>::max();
+    unsigned long seed=0;
+    /// size of thread pool. 0 means use the number of hardware threads
+    unsigned nThreads=0;
+
+    struct Run
+    {
+      std::vector<double> parameters, outputs;
+      /// simulation time the run finished at
+      double t=0;
+      /// empty unless the run failed, in which case outputs are NaN
+      std::string error;
+    };
+    /// one entry per run, in run order
+    std::vector<Run> results;
+
+    /// total number of runs in the sweep
+    size_t numRuns() const;
+    /// parameter values used by run \a i
+    std::vector<double> parameterValues(size_t i) const;
+
+    /// perform the sweep on the model stored in \a filename
+    /// @throw if the model cannot be loaded, or refers to unknown variables
+    void run(const std::string& filename);
+
+    /// write results as comma separated values, one row per run
+    void writeCSV(std::ostream&) const;
+  };
+}
+
+#endif
@@ -0,0 +1,368 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "plotSeries.h"
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+using namespace std;
+
+namespace minsky
+{
+  namespace
+  {
+    /// number of samples buffered before writing to a spill file
+    const size_t spillBufferSamples=4096;
+  }
+
+  SpillFile::SpillFile(const string& filename): m_filename(filename)
+  {
+#ifdef _WIN32
+    fd=open(filename.c_str(), O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0600);
+#else
+    fd=open(filename.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0600);
+#endif
+    if (fd<0)
+      throw runtime_error("cannot create spill file "+filename);
+  }
+
+  SpillFile::~SpillFile()
+  {
+    unmap();
+    close(fd);
+    remove(m_filename.c_str());
+  }
+
+  void SpillFile::append(double x, double y)
+  {
+    buffer.push_back(x);
+    buffer.push_back(y);
+    if (buffer.size()>=2*spillBufferSamples)
+      writeBuffer();
+  }
+
+  void SpillFile::writeBuffer()
+  {
+    const char* p=reinterpret_cast<const char*>(buffer.data());
+    size_t remaining=buffer.size()*sizeof(double);
+    while (remaining)
+      {
+        auto n=write(fd, p, remaining);
+        if (n<=0)
+          throw runtime_error("failed to write spill file "+m_filename);
+        p+=n;
+        remaining-=n;
+      }
+    written+=buffer.size()/2;
+    buffer.clear();
+  }
+
+  void SpillFile::unmap() const
+  {
+#ifndef _WIN32
+    if (map)
+      munmap(const_cast<double*>(map), 2*mapped*sizeof(double));
+#endif
+    map=nullptr;
+    mapped=0;
+  }
+
+  const double* SpillFile::sample(size_t i) const
+  {
+    if (i>=written)
+      return &buffer[2*(i-written)];
+#ifdef _WIN32
+    if (lseek(fd, 2*i*sizeof(double), SEEK_SET)<0 ||
+        read(fd, scratch, sizeof(scratch))!=sizeof(scratch))
+      throw runtime_error("failed to read spill file "+m_filename);
+    lseek(fd, 0, SEEK_END);
+    return scratch;
+#else
+    if (i>=mapped)
+      {
+        // remap to cover everything written so far
+        unmap();
+        void* m=mmap(nullptr, 2*written*sizeof(double), PROT_READ, MAP_SHARED, fd, 0);
+        if (m==MAP_FAILED)
+          throw runtime_error("failed to map spill file "+m_filename);
+        map=static_cast<const double*>(m);
+        mapped=written;
+      }
+    return map+2*i;
+#endif
+  }
+
+  const size_t PlotSeries::fanout;
+
+  PlotSeries& PlotSeries::operator=(const PlotSeries& x)
+  {
+    if (this==&x) return *this;
+    xs=x.xs;
+    ys=x.ys;
+    base=x.base;
+    count=x.count;
+    m_maxSamples=x.m_maxSamples;
+    m_maxTime=x.m_maxTime;
+    m_monotonic=x.m_monotonic;
+    levels=x.levels;
+    levelStart=x.levelStart;
+    spill.reset();
+    spillStart=0;
+    return *this;
+  }
+
+  void PlotSeries::clear()
+  {
+    xs.clear();
+    ys.clear();
+    base=count=0;
+    levels.clear();
+    levelStart.clear();
+    m_monotonic=true;
+    if (spill)
+      {
+        auto filename=spill->filename();
+        spill.reset();
+        spill.reset(new SpillFile(filename));
+      }
+    spillStart=0;
+  }
+
+  void PlotSeries::merge(Extrema& a, const Extrema& b) const
+  {
+    if (y(b.min)<y(a.min) || std::isnan(y(a.min))) a.min=b.min;
+    if (y(b.max)>y(a.max) || std::isnan(y(a.max))) a.max=b.max;
+  }
+
+  void PlotSeries::reserve(size_t capacity)
+  {
+    vector<double> newXs(capacity), newYs(capacity);
+    for (size_t i=base; i<end(); ++i)
+      {
+        newXs[i%capacity]=xs[slot(i)];
+        newYs[i%capacity]=ys[slot(i)];
+      }
+    xs.swap(newXs);
+    ys.swap(newYs);
+  }
+
+  void PlotSeries::evict(size_t n)
+  {
+    for (; n>0 && count>0; --n)
+      {
+        if (spill)
+          spill->append(xs[slot(base)], ys[slot(base)]);
+        ++base;
+        --count;
+      }
+    // drop pyramid blocks lying wholly before the retained samples
+    size_t block=fanout;
+    for (size_t l=0; l<levels.size(); ++l, block*=fanout)
+      for (; !levels[l].empty() && (levelStart[l]+1)*block<=base; ++levelStart[l])
+        levels[l].pop_front();
+  }
+
+  void PlotSeries::applyRetention()
+  {
+    if (m_maxSamples && count>m_maxSamples)
+      evict(count-m_maxSamples);
+    if (m_maxTime>0)
+      {
+        size_t n=0;
+        double latest=xs[slot(end()-1)];
+        while (n+1<count && xs[slot(base+n)]<latest-m_maxTime) ++n;
+        if (n) evict(n);
+      }
+  }
+
+  void PlotSeries::retain(size_t maxSamples, double maxTime)
+  {
+    m_maxSamples=maxSamples;
+    m_maxTime=maxTime;
+    if (empty()) return;
+    applyRetention();
+    if (m_maxSamples && xs.size()>m_maxSamples)
+      reserve(m_maxSamples);
+  }
+
+  void PlotSeries::spillTo(const string& filename)
+  {
+    spill.reset();
+    if (!filename.empty())
+      spill.reset(new SpillFile(filename));
+    spillStart=base;
+  }
+
+  void PlotSeries::append(double x, double y)
+  {
+    if (count && x<xs[slot(end()-1)]) m_monotonic=false;
+    if (count==xs.size())
+      {
+        if (m_maxSamples && count>=m_maxSamples)
+          evict(1);
+        else
+          {
+            size_t capacity=max(size_t(16), 2*xs.size());
+            if (m_maxSamples) capacity=min(capacity, m_maxSamples);
+            reserve(capacity);
+          }
+      }
+    size_t i=end();
+    xs[slot(i)]=x;
+    ys[slot(i)]=y;
+    ++count;
+
+    // levels[l] has blocks of fanout^(l+1) samples, and is created
+    // once there is more than one block of the level below
+    Extrema e{i,i};
+    size_t block=fanout;
+    for (size_t l=0; block/fanout<=i; ++l, block*=fanout)
+      {
+        if (l==levels.size())
+          {
+            levels.emplace_back(1, extrema(base,i+1));
+            levelStart.push_back(0);
+            continue;
+          }
+        auto& level=levels[l];
+        size_t j=i/block-levelStart[l];
+        if (j==level.size())
+          level.push_back(e);
+        else if (level[j].min<base || level[j].max<base)
+          // block partially evicted, so will not be consulted
+          level[j]=e;
+        else
+          merge(level[j], e);
+      }
+
+    if (m_maxTime>0)
+      applyRetention();
+  }
+
+  PlotSeries::Extrema PlotSeries::extrema(size_t begin, size_t end) const
+  {
+    Extrema r{begin,begin};
+    size_t i=begin;
+    // spilled samples are not summarised by the pyramid
+    for (; i<min(end,base); ++i)
+      merge(r, Extrema{i,i});
+    while (i<end)
+      {
+        // use the largest block aligned at i lying within [i,end)
+        size_t l=0, block=1;
+        while (l<levels.size() && i%(block*fanout)==0 && i+block*fanout<=end)
+          {
+            block*=fanout;
+            ++l;
+          }
+        if (l)
+          merge(r, levels[l-1][i/block-levelStart[l-1]]);
+        else
+          merge(r, Extrema{i,i});
+        i+=block;
+      }
+    return r;
+  }
+
+  size_t PlotSeries::lowerBound(size_t begin, size_t end, double v) const
+  {
+    while (begin<end)
+      {
+        size_t mid=begin+(end-begin)/2;
+        if (x(mid)<v)
+          begin=mid+1;
+        else
+          end=mid;
+      }
+    return begin;
+  }
+
+  void PlotSeries::decimate(size_t buckets, vector<double>& xd, vector<double>& yd,
+                            double xmin, double xmax) const
+  {
+    if (m_monotonic)
+      {
+        size_t begin=lowerBound(first(), end(), xmin);
+        // first index with x>xmax
+        size_t e=begin;
+        for (size_t n=end()-begin; n>0;)
+          {
+            size_t half=n/2;
+            if (x(e+half)<=xmax)
+              {
+                e+=half+1;
+                n-=half+1;
+              }
+            else
+              n=half;
+          }
+        decimateIndices(buckets,xd,yd,begin,e);
+      }
+    else
+      {
+        xd.clear();
+        yd.clear();
+        for (size_t i=first(); i<end(); ++i)
+          if (x(i)>=xmin && x(i)<=xmax)
+            {
+              xd.push_back(x(i));
+              yd.push_back(y(i));
+            }
+      }
+  }
+
+  void PlotSeries::decimateIndices(size_t buckets, vector<double>& xd, vector<double>& yd,
+                                   size_t begin, size_t end) const
+  {
+    xd.clear();
+    yd.clear();
+    if (!m_monotonic || end-begin<=4*buckets || buckets==0)
+      {
+        for (size_t i=begin; i<end; ++i)
+          {
+            xd.push_back(x(i));
+            yd.push_back(y(i));
+          }
+        return;
+      }
+
+    // divide x range into equal width buckets, and emit the first,
+    // minimum, maximum and last points of each
+    double x0=x(begin), dx=(x(end-1)-x0)/buckets;
+    for (size_t b=1; b<=buckets && begin<end; ++b)
+      {
+        size_t bucketEnd=b==buckets? end: lowerBound(begin, end, x0+b*dx);
+        if (bucketEnd==begin) continue;
+        auto e=extrema(begin,bucketEnd);
+        size_t idx[]={begin, min(e.min,e.max), max(e.min,e.max), bucketEnd-1};
+        for (size_t k=0; k<4; ++k)
+          if (k==0 || idx[k]!=idx[k-1])
+            {
+              xd.push_back(x(idx[k]));
+              yd.push_back(y(idx[k]));
+            }
+        begin=bucketEnd;
+      }
+  }
+}
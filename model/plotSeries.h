@@ -0,0 +1,167 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PLOTSERIES_H
+#define PLOTSERIES_H
+
+#include <deque>
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace minsky
+{
+  /**
+     Backing store for samples evicted from a PlotSeries, so that
+     history can be scrolled back to without holding it in memory.
+     Samples are stored as (x,y) pairs of doubles in native byte
+     order, and read back through a memory mapping of the file. The
+     file is removed when the SpillFile is destroyed.
+  */
+  class SpillFile
+  {
+  public:
+    /// @throw std::runtime_error if \a filename cannot be created
+    SpillFile(const std::string& filename);
+    ~SpillFile();
+    const std::string& filename() const {return m_filename;}
+    /// number of samples stored
+    size_t size() const {return written+buffer.size()/2;}
+    void append(double x, double y);
+    double x(size_t i) const {return sample(i)[0];}
+    double y(size_t i) const {return sample(i)[1];}
+  private:
+    std::string m_filename;
+    int fd=-1;
+    size_t written=0; ///< number of samples on disk
+    /// samples not yet written to disk
+    std::vector<double> buffer;
+    mutable const double* map=nullptr;
+    mutable size_t mapped=0; ///< number of samples mapped
+    mutable double scratch[2]; ///< used where the file cannot be mapped
+    const double* sample(size_t i) const;
+    void writeBuffer();
+    void unmap() const;
+    SpillFile(const SpillFile&)=delete;
+    void operator=(const SpillFile&)=delete;
+  };
+
+  /**
+     The sequence of points plotted by a pen, together with a pyramid
+     of the minimum and maximum y values over blocks of fanout^l
+     samples at each level l. This allows the series to be reduced to
+     a few points per pixel column (first, minimum, maximum and last)
+     at a cost proportional to the number of columns, rather than the
+     number of samples, whilst drawing identically.
+
+     By default all samples are retained. A retention policy bounds
+     the samples held in memory to the most recent maxSamples, or
+     those within maxTime of the latest x, in a ring buffer. Evicted
+     samples are discarded, or written to a SpillFile if one has been
+     set, from where they remain accessible.
+
+     Samples are indexed by the order in which they were appended,
+     with those in [first(),end()) accessible.
+  */
+  class PlotSeries
+  {
+  public:
+    static const size_t fanout=8;
+
+    PlotSeries() {}
+    /// copies share no spill file, so only retained samples are copied
+    PlotSeries(const PlotSeries& x) {*this=x;}
+    PlotSeries& operator=(const PlotSeries&);
+    PlotSeries(PlotSeries&&)=default;
+    PlotSeries& operator=(PlotSeries&&)=default;
+
+    void append(double x, double y);
+    /// remove all samples, including those spilled
+    void clear();
+    /// index of oldest accessible sample
+    size_t first() const {return spill? spillStart: base;}
+    /// index of the oldest sample held in memory
+    size_t firstRetained() const {return base;}
+    /// one past the index of the latest sample
+    size_t end() const {return base+count;}
+    /// number of accessible samples
+    size_t size() const {return end()-first();}
+    bool empty() const {return count==0;}
+    double x(size_t i) const {return i<base? spill->x(i-spillStart): xs[slot(i)];}
+    double y(size_t i) const {return i<base? spill->y(i-spillStart): ys[slot(i)];}
+    /// true if x is nondecreasing, so that samples can be bucketed
+    /// by index
+    bool monotonic() const {return m_monotonic;}
+
+    /// set the retention policy. Zero values are unlimited.
+    void retain(size_t maxSamples, double maxTime);
+    size_t maxSamples() const {return m_maxSamples;}
+    double maxTime() const {return m_maxTime;}
+    /// write evicted samples to \a filename. An empty filename
+    /// discards any spilled history, and subsequently evicted samples
+    void spillTo(const std::string& filename);
+    const SpillFile* spillFile() const {return spill.get();}
+
+    /// reduce the retained samples to at most 4*\a buckets points,
+    /// stored in \a x and \a y. If there are no more than that, or the
+    /// series is not monotonic in x, the samples are returned
+    /// unreduced.
+    void decimate(size_t buckets, std::vector<double>& x, std::vector<double>& y) const
+    {decimateIndices(buckets,x,y,base,end());}
+    /// as above, for accessible samples whose x lies in [\a xmin,\a xmax]
+    void decimate(size_t buckets, std::vector<double>& x, std::vector<double>& y,
+                  double xmin, double xmax) const;
+
+  private:
+    /// ring buffers of retained samples, sample i being stored at
+    /// slot(i)
+    std::vector<double> xs, ys;
+    size_t base=0, count=0;
+    size_t m_maxSamples=0;
+    double m_maxTime=0;
+    bool m_monotonic=true;
+    std::unique_ptr<SpillFile> spill;
+    size_t spillStart=0; ///< index of first sample in spill
+    struct Extrema
+    {
+      size_t min, max; ///< indices of minimum and maximum y
+    };
+    /// levels[l-1][j-levelStart[l-1]] summarises samples [j*fanout^l,
+    /// (j+1)*fanout^l). Blocks preceding firstRetained() are dropped.
+    std::vector<std::deque<Extrema>> levels;
+    std::vector<size_t> levelStart;
+
+    size_t slot(size_t i) const {return i%xs.size();}
+    /// first index in [\a begin,\a end) whose x is not less than \a v
+    size_t lowerBound(size_t begin, size_t end, double v) const;
+    /// extrema of samples [begin,end)
+    Extrema extrema(size_t begin, size_t end) const;
+    void merge(Extrema&, const Extrema&) const;
+    /// set the ring buffer capacity, which must be at least count
+    void reserve(size_t capacity);
+    /// drop the oldest \a n retained samples, spilling them if required
+    void evict(size_t n);
+    void applyRetention();
+    /// decimate samples [\a begin,\a end)
+    void decimateIndices(size_t buckets, std::vector<double>& x, std::vector<double>& y,
+                         size_t begin, size_t end) const;
+  };
+}
+
+#endif
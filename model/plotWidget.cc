@@ -23,6 +23,7 @@
 #include "latexMarkup.h"
 #include "pango.h"
 #include <timer.h>
+#include <boost/filesystem.hpp>
 
 #include <ecolab_epilogue.h>
 using namespace ecolab::cairo;
@@ -110,6 +111,7 @@ namespace minsky
 
     yvars.resize(2*numLines);
     xvars.resize(numLines);
+    series.resize(2*numLines);
    }
 
   void PlotWidget::draw(cairo_t* cairo) const
@@ -194,6 +196,8 @@ namespace minsky
 
     cairo_translate(cairo, 10*zoomFactor,yoffs);
     cairo_set_line_width(cairo,1);
+    if (seriesChanged)
+      const_cast<PlotWidget*>(this)->updatePens();
     Plot::draw(cairo,w-20*zoomFactor,h-10); // allow space for ports
     
     cairo_restore(cairo);
@@ -227,9 +231,92 @@ namespace minsky
 
   extern Tk_Window mainWin;
 
+  void PlotWidget::updatePens()
+  {
+    if (!seriesChanged) return;
+    vector<double> x, y;
+    for (size_t pen=0; pen<series.size(); ++pen)
+      if (!series[pen].empty())
+        {
+          if (showingHistory)
+            series[pen].decimate(displayResolution, x, y, historyMin, historyMax);
+          else
+            series[pen].decimate(displayResolution, x, y);
+          setPen(pen, x.data(), y.data(), x.size());
+        }
+    seriesChanged=false;
+  }
+
+  void PlotWidget::applyRetention(PlotSeries& s)
+  {
+    if (s.maxSamples()!=maxSamples || s.maxTime()!=maxTime)
+      s.retain(maxSamples, maxTime);
+    if (spillToDisk && !s.spillFile())
+      {
+        using namespace boost::filesystem;
+        s.spillTo((temp_directory_path()/unique_path("minsky-%%%%-%%%%-%%%%.spill")).string());
+      }
+    else if (!spillToDisk && s.spillFile())
+      s.spillTo("");
+  }
+
+  void PlotWidget::clear()
+  {
+    Plot::clear();
+    for (auto& s: series) s.clear();
+    seriesChanged=false;
+  }
+
+  void PlotWidget::showHistory(double xmin, double xmax)
+  {
+    historyMin=xmin;
+    historyMax=xmax;
+    showingHistory=true;
+    seriesChanged=true;
+    redraw();
+  }
+
+  void PlotWidget::showLatest()
+  {
+    showingHistory=false;
+    seriesChanged=true;
+    redraw();
+  }
+
+  void PlotWidget::exportAsCSV(const string& filename)
+  {
+    // load the full resolution samples into the pens for the export,
+    // then restore the decimated ones
+    vector<double> x, y;
+    for (size_t pen=0; pen<series.size(); ++pen)
+      if (!series[pen].empty())
+        {
+          x.clear(); y.clear();
+          for (size_t i=series[pen].first(); i<series[pen].end(); ++i)
+            {
+              x.push_back(series[pen].x(i));
+              y.push_back(series[pen].y(i));
+            }
+          setPen(pen, x.data(), y.data(), x.size());
+        }
+    try
+      {
+        ecolab::Plot::exportAsCSV(filename);
+      }
+    catch (...)
+      {
+        seriesChanged=true;
+        updatePens();
+        throw;
+      }
+    seriesChanged=true;
+    updatePens();
+  }
+
   void PlotWidget::redraw()
   {
     justDataChanged=true; // assume plot same size, don't do unnecessary stuff
+    updatePens();
     // store previous min/max values to determine if plot scale changes
     scalePlot();
     if (surface.get())
@@ -278,7 +365,9 @@ namespace minsky
                 throw error("x input not wired for pen %d",(int)pen+1);
               break;
             }
-          addPt(pen, x, y);
+          applyRetention(series[pen]);
+          series[pen].append(x, y);
+          seriesChanged=true;
         }
     
     // throttle plot redraws
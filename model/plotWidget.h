@@ -23,6 +23,7 @@
 #include <TCL_obj_base.h>
 #include "classdesc_access.h"
 #include "plot.h"
+#include "plotSeries.h"
 #include "variable.h"
 #include "zoom.h"
 
@@ -48,6 +49,18 @@ namespace minsky
     // draw(), which is const, so this attribute needs to be mutable.
     mutable bool justDataChanged=false;
     friend struct PlotItem;
+    /// full resolution data of the time series pens. The underlying
+    /// Plot is given a decimated copy of these for drawing
+    classdesc::Exclude<std::vector<PlotSeries>> series;
+    /// set when series has data not yet passed to the Plot
+    mutable bool seriesChanged=false;
+    /// pass decimated series data to the Plot for drawing
+    void updatePens();
+    /// x range of history being shown, if showingHistory
+    double historyMin=0, historyMax=0;
+    bool showingHistory=false;
+    /// bring \a s into line with the retention policy
+    void applyRetention(PlotSeries& s);
   public:
     using Item::x;
     using Item::y;
@@ -61,6 +74,19 @@ namespace minsky
     VariableValue xminVar, xmaxVar, yminVar, ymaxVar, y1minVar, y1maxVar;
     /// number of ticks to show in canvas item
     unsigned displayNTicks{3};
+    /// number of columns time series are reduced to for drawing,
+    /// which should be at least the plot's width in pixels
+    unsigned displayResolution{2048};
+    /// retention policy for time series data. Only the most recent
+    /// maxSamples samples of each pen, and those within maxTime of
+    /// the latest x value are held in memory. Zero values are
+    /// unlimited.
+    unsigned maxSamples{0};
+    double maxTime{0};
+    /// if true, samples discarded by the retention policy are
+    /// written to a temporary file, from where they can be shown by
+    /// showHistory()
+    bool spillToDisk{false};
     double displayFontSize{3};
 
 
@@ -80,7 +106,15 @@ namespace minsky
     void draw(cairo_t* cairo) const override;
     void redraw(); // redraw plot using current data to all open windows
     void redraw(int x0, int y0, int width, int height) override
-    {if (surface.get()) {Plot::draw(surface->cairo(),width,height); surface->blit();}}
+    {if (surface.get()) {updatePens(); Plot::draw(surface->cairo(),width,height); surface->blit();}}
+    /// clear all plotted data
+    void clear();
+    /// show time series data, including any spilled to disk, over
+    /// the x range [\a xmin,\a xmax]
+    void showHistory(double xmin, double xmax);
+    /// show the retained time series data, following new data as
+    /// it is added
+    void showLatest();
    
     /// add this as a display plot to its group
     void makeDisplayPlot();
@@ -92,9 +126,11 @@ namespace minsky
     /// sets the plot scale and pen labels
     void scalePlot();
 
-    /// export the plotted data as a CSV file
+    /// export the plotted data as a CSV file. Time series are
+    /// exported at full resolution, including any history spilled
+    /// to disk
     // implemented as a single argument function here for exposure to TCL
-    void exportAsCSV(const string& filename) {ecolab::Plot::exportAsCSV(filename);}
+    void exportAsCSV(const string& filename);
  };
 
 }
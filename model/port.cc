@@ -42,8 +42,8 @@ namespace minsky
 
   void Port::moveTo(float x, float y)
   {
-    m_x=x-item.x();
-    m_y=y-item.y();
+    setGeometry(item,m_x,x-item.x());
+    setGeometry(item,m_y,y-item.y());
   }
 
   GroupPtr Port::group() const
@@ -338,15 +338,18 @@ namespace minsky
             bool numerical=
               all_of(labels.begin(), labels.end(),
                      [](const char* i){return isdigit(*i)||*i=='.';});
-            data.clear(); xVector.clear();
+            xVector.clear();
+            vector<double> x, y;
             for (size_t i=0; i<dims[0]; ++i)
               if (isfinite(tmp[i]))
                 {
                   // i+1 allows logarithmic scales to be used
                   double v=numerical? stod(labels[i]): double(i+1);
-                  data[v]=tmp[i];
+                  x.push_back(v);
+                  y.push_back(tmp[i]);
                   xVector.emplace_back(v,labels[i]);
                 }
+            data.assign(move(x), move(y));
             assert(data.size()==xVector.size());
             minsky().reset();
           }
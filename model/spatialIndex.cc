@@ -0,0 +1,319 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "spatialIndex.h"
+#include "group.h"
+#include "port.h"
+#include "wire.h"
+#include <ecolab_epilogue.h>
+#include <functional>
+using namespace std;
+
+namespace minsky
+{
+  namespace
+  {
+    /// bounding box of \a i, enlarged to include its ports, and
+    /// anything else (eg slider handles) within half its size of it
+    void itemBox(const Item& i, float& x0, float& y0, float& x1, float& y1)
+    {
+      float margin=0.5*i.zoomFactor*max(i.width(),i.height())+portRadius*i.zoomFactor;
+      x0=i.left(); x1=i.right(); y0=i.bottom(); y1=i.top();
+      for (auto& p: i.ports)
+        if (p)
+          {
+            x0=min(x0,p->x()); x1=max(x1,p->x());
+            y0=min(y0,p->y()); y1=max(y1,p->y());
+          }
+      x0-=margin; y0-=margin; x1+=margin; y1+=margin;
+    }
+
+    /// bounding box of \a w, returning false if it has no extent
+    bool wireBox(const Wire& w, float& x0, float& y0, float& x1, float& y1)
+    {
+      auto c=w.coords();
+      if (c.size()<4) return false;
+      x0=x1=c[0]; y0=y1=c[1];
+      for (size_t i=2; i<c.size()-1; i+=2)
+        {
+          x0=min(x0,c[i]); x1=max(x1,c[i]);
+          y0=min(y0,c[i+1]); y1=max(y1,c[i+1]);
+        }
+      // Wire::near() accepts points within an ellipse around
+      // straight wires, whose semi-minor axis grows with length
+      float dx=c[c.size()-2]-c[0], dy=c.back()-c[1], d=sqrt(dx*dx+dy*dy);
+      float margin=0.5*sqrt(10*d+25)+1;
+      x0-=margin; y0-=margin; x1+=margin; y1+=margin;
+      return true;
+    }
+
+    /// key identifying \a i in the item and group grids
+    const void* id(const Item* i) {return i;}
+  }
+
+  CanvasIndex::~CanvasIndex()
+  {
+    if (auto m=model.lock())
+      if (m->canvasIndex.index==this)
+        m->canvasIndex.index=nullptr;
+  }
+
+  void CanvasIndex::detach(Group& model)
+  {
+    model.canvasIndex.index=nullptr;
+  }
+
+  CanvasIndex* CanvasIndex::observer(const Item& i)
+  {
+    // the canvas model is detached from its parent group while
+    // displayed, so is the outermost group of the objects it contains
+    const Item* outer=&i;
+    for (auto g=i.group.lock(); g; g=g->group.lock())
+      outer=g.get();
+    auto g=dynamic_cast<const Group*>(outer);
+    return g? g->canvasIndex.index: nullptr;
+  }
+
+  CanvasIndex* CanvasIndex::observer(const Wire& w)
+  {
+    if (auto f=w.from())
+      return observer(f->item);
+    if (auto t=w.to())
+      return observer(t->item);
+    return nullptr;
+  }
+
+  template <class F> void CanvasIndex::record(CanvasIndex* c, F f)
+  {
+    if (c && !c->overflow)
+      {
+        f(*c);
+        if (c->tooManyChanges())
+          {
+            // cheaper to rebuild on next update
+            c->overflow=true;
+            c->changes.clear();
+            c->movedItems.clear();
+            c->movedWires.clear();
+          }
+      }
+  }
+
+  bool CanvasIndex::tooManyChanges() const
+  {
+    return changes.size()+movedItems.size()+movedWires.size() >
+      items.size()+groups.size()+wires.size()+1024;
+  }
+
+  void CanvasIndex::added(const shared_ptr<Item>& i)
+  {record(observer(*i), [&](CanvasIndex& c) {c.changes.push_back(Change{Change::addItem,id(i.get()),i,{},{}});});}
+
+  void CanvasIndex::added(const shared_ptr<Wire>& w, const weak_ptr<Group>& owner)
+  {
+    if (auto o=owner.lock())
+      record(observer(*o), [&](CanvasIndex& c) {c.changes.push_back(Change{Change::addWire,w.get(),{},w,owner});});
+  }
+
+  void CanvasIndex::removed(const Item& i)
+  {record(observer(i), [&](CanvasIndex& c) {c.changes.push_back(Change{Change::removeItem,id(&i),{},{},{}});});}
+
+  void CanvasIndex::removed(const Wire& w)
+  {record(observer(w), [&](CanvasIndex& c) {c.changes.push_back(Change{Change::removeWire,&w,{},{},{}});});}
+
+  void CanvasIndex::moved(const Item& i)
+  {record(observer(i), [&](CanvasIndex& c) {c.movedItems.insert(&i);});}
+
+  void CanvasIndex::moved(const Wire& w)
+  {record(observer(w), [&](CanvasIndex& c) {c.movedWires.insert(&w);});}
+
+  void CanvasIndex::update(const shared_ptr<Group>& m)
+  {
+    auto prev=model.lock();
+    if (overflow || m!=prev || m->canvasIndex.index!=this ||
+        // moving the model moves everything
+        movedItems.count(m.get()))
+      {
+        if (prev && prev!=m && prev->canvasIndex.index==this)
+          prev->canvasIndex.index=nullptr;
+        model=m;
+        m->canvasIndex.index=this;
+        overflow=false;
+        changes.clear();
+        movedItems.clear();
+        movedWires.clear();
+        rebuild(*m);
+        return;
+      }
+
+    vector<Change> changes;
+    unordered_set<const Item*> movedItems;
+    unordered_set<const Wire*> movedWires;
+    changes.swap(this->changes);
+    movedItems.swap(this->movedItems);
+    movedWires.swap(this->movedWires);
+
+    for (auto& c: changes)
+      switch (c.type)
+        {
+        case Change::addItem:
+          if (auto i=c.item.lock())
+            if (inModel(*i))
+              insert(i);
+          break;
+        case Change::addWire:
+          if (auto w=c.wire.lock())
+            if (auto owner=c.owner.lock())
+              if (owner==m || inModel(*owner))
+                insert(w, *owner);
+          break;
+        case Change::removeItem:
+          eraseItem(c.id);
+          break;
+        case Change::removeWire:
+          wires.erase(c.id);
+          break;
+        }
+
+    // positions are read when relocating, so each object need only
+    // be relocated once
+    for (auto i: movedItems)
+      relocate(i);
+    for (auto w: movedWires)
+      relocate(w);
+  }
+
+  void CanvasIndex::rebuild(const Group& model)
+  {
+    items.clear();
+    groups.clear();
+    wires.clear();
+    float x0, y0, x1, y1;
+    model.recursiveDo
+      (&GroupItems::items, [&](const Items&, Items::const_iterator i)
+       {
+         itemBox(**i, x0, y0, x1, y1);
+         items.insert(id(i->get()), *i, (*i)->group.lock().get(), x0, y0, x1, y1);
+         return false;
+       });
+    model.recursiveDo
+      (&GroupItems::groups, [&](const Groups&, Groups::const_iterator i)
+       {
+         itemBox(**i, x0, y0, x1, y1);
+         groups.insert(id(i->get()), *i, (*i)->group.lock().get(), x0, y0, x1, y1);
+         return false;
+       });
+    // wires are owned by the group whose wire list holds them
+    function<void(const Group&)> addWires=[&](const Group& g) {
+      for (auto& w: g.wires)
+        if (wireBox(*w, x0, y0, x1, y1))
+          wires.insert(w.get(), w, &g, x0, y0, x1, y1);
+      for (auto& sg: g.groups)
+        addWires(*sg);
+    };
+    addWires(model);
+
+    items.build();
+    groups.build();
+    wires.build();
+  }
+
+  bool CanvasIndex::inModel(const Item& i) const
+  {
+    auto m=model.lock();
+    for (auto g=i.group.lock(); g; g=g->group.lock())
+      if (g==m)
+        return true;
+    return false;
+  }
+
+  void CanvasIndex::insert(const shared_ptr<Item>& i)
+  {
+    float x0, y0, x1, y1;
+    itemBox(*i, x0, y0, x1, y1);
+    if (auto g=dynamic_pointer_cast<Group>(i))
+      {
+        groups.insert(id(g.get()), g, g->group.lock().get(), x0, y0, x1, y1);
+        for (auto& j: g->items) insert(j);
+        for (auto& j: g->groups) insert(j);
+        for (auto& w: g->wires) insert(w, *g);
+      }
+    else
+      items.insert(id(i.get()), i, i->group.lock().get(), x0, y0, x1, y1);
+  }
+
+  void CanvasIndex::insert(const shared_ptr<Wire>& w, const Group& owner)
+  {
+    float x0, y0, x1, y1;
+    if (wireBox(*w, x0, y0, x1, y1))
+      wires.insert(w.get(), w, &owner, x0, y0, x1, y1);
+  }
+
+  void CanvasIndex::eraseItem(const void* k)
+  {
+    if (auto e=groups.get(k))
+      {
+        auto g=e->obj; // erasing releases the entry's reference
+        groups.erase(k);
+        for (auto& j: g->items) eraseItem(id(j.get()));
+        for (auto& j: g->groups) eraseItem(id(j.get()));
+        for (auto& w: g->wires) wires.erase(w.get());
+      }
+    else
+      items.erase(k);
+  }
+
+  void CanvasIndex::relocate(const Item* i)
+  {
+    // objects are only dereferenced if indexed, which keeps them alive
+    float x0, y0, x1, y1;
+    if (auto e=items.get(i))
+      {
+        auto item=e->obj;
+        itemBox(*item, x0, y0, x1, y1);
+        items.move(i, x0, y0, x1, y1);
+        relocateWires(*item);
+      }
+    else if (auto e=groups.get(i))
+      {
+        auto g=e->obj;
+        itemBox(*g, x0, y0, x1, y1);
+        groups.move(i, x0, y0, x1, y1);
+        relocateWires(*g);
+        // contents are positioned relative to the group
+        for (auto& j: g->items) relocate(j.get());
+        for (auto& j: g->groups) relocate(j.get());
+        for (auto& w: g->wires) relocate(w.get());
+      }
+  }
+
+  void CanvasIndex::relocate(const Wire* w)
+  {
+    float x0, y0, x1, y1;
+    if (auto e=wires.get(w))
+      if (wireBox(*e->obj, x0, y0, x1, y1))
+        wires.move(w, x0, y0, x1, y1);
+  }
+
+  void CanvasIndex::relocateWires(const Item& i)
+  {
+    for (auto& p: i.ports)
+      if (p)
+        for (auto w: p->wires())
+          relocate(w);
+  }
+}
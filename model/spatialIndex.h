@@ -0,0 +1,390 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace minsky
+{
+  class Item;
+  class Group;
+  class Wire;
+
+  /// uniform grid of the bounding boxes of canvas objects of type
+  /// T, for finding those near a point or within a region without
+  /// visiting all of them
+  template <class T>
+  class SpatialGrid
+  {
+  public:
+    struct Entry
+    {
+      T obj;
+      const void* id; ///< key identifying obj
+      const Group* group; ///< group owning obj
+      float x0, y0, x1, y1; ///< bounding box
+    };
+
+    void clear() {entries.clear(); slots.clear(); cells.clear(); large.clear(); built=false;}
+    size_t size() const {return slots.size();}
+    /// entry of the object identified by \a id, or nullptr if absent
+    const Entry* get(const void* id) const {
+      auto s=slots.find(id);
+      return s==slots.end()? nullptr: &entries[s->second];
+    }
+    /// add \a obj, identified by \a id and owned by \a group, with
+    /// bounding box [x0,x1]×[y0,y1], or update it if already
+    /// present. Once build() has been called, only the cells
+    /// overlapping the box are updated.
+    void insert(const void* id, const T& obj, const Group* group, float x0, float y0, float x1, float y1);
+    /// change the bounding box of the object identified by \a id, if present
+    void move(const void* id, float x0, float y0, float x1, float y1);
+    /// remove the object identified by \a id, if present
+    void erase(const void* id);
+    /// index the entries inserted
+    void build();
+
+    /// returns the first object, in insertion order, whose bounding
+    /// box contains (\a x,\a y) and which satisfies \a c, or a null
+    /// object if none. C has signature bool(const T&)
+    template <class C> T find(float x, float y, C c) const;
+    /// calls \a f(entry), in insertion order, for entries whose
+    /// bounding box intersects [x0,x1]×[y0,y1]. F has signature
+    /// void(const Entry&)
+    template <class F> void forEach(float x0, float y0, float x1, float y1, F f) const;
+
+  private:
+    /// in insertion order, with null objects where entries were erased
+    std::vector<Entry> entries;
+    /// position in entries of each object's entry
+    std::unordered_map<const void*, unsigned> slots;
+    bool built=false;
+    float cellSize=1;
+    /// entries overlapping each cell, in insertion order
+    std::unordered_map<uint64_t, std::vector<unsigned>> cells;
+    /// entries spanning too many cells to be gridded, which are
+    /// checked by every query
+    std::vector<unsigned> large;
+    mutable std::vector<unsigned> candidates;
+    static const int maxCellsPerEntry=64;
+
+    int cell(float v) const {return int(std::floor(v/cellSize));}
+    static uint64_t key(int i, int j) {return uint64_t(uint32_t(i))<<32 | uint32_t(j);}
+    bool contains(const Entry& e, float x, float y) const
+    {return e.x0<=x && x<=e.x1 && e.y0<=y && y<=e.y1;}
+    bool isLarge(int i0, int i1, int j0, int j1) const
+    {return (i1-i0+1.0)*(j1-j0+1.0)>maxCellsPerEntry;}
+    /// add or remove entry \a i to or from the cells it overlaps
+    void grid(unsigned i);
+    void ungrid(unsigned i);
+    static void insertSorted(std::vector<unsigned>& v, unsigned i)
+    {v.insert(std::lower_bound(v.begin(), v.end(), i), i);}
+    static void eraseSorted(std::vector<unsigned>& v, unsigned i) {
+      auto j=std::lower_bound(v.begin(), v.end(), i);
+      if (j!=v.end() && *j==i) v.erase(j);
+    }
+  };
+
+  class CanvasIndex;
+  /// the index a group is attached to, if any. See CanvasIndex
+  struct CanvasIndexRef
+  {
+    CanvasIndex* index=nullptr;
+  };
+
+  /**
+     Spatial indices of the items, groups and wires of a model in
+     canvas coordinates, used for hit testing and lasso selection.
+
+     Each Canvas owns an index of the group it displays, which
+     attaches itself to that group when updated. Anything changing
+     the position, size or membership of an item, group or wire must
+     record it with added(), removed() or moved(), which pass the
+     change to the index attached to the outermost group containing
+     the object, if any. Models not displayed on a canvas, such as
+     those of parameter sweep workers, have no index attached, so
+     their changes are not recorded. Changes are applied on the
+     index's next update(), touching only the grid cells of the
+     objects concerned, and must be recorded on the thread that
+     updates the index. Wholesale changes, such as switching the
+     canvas model, detach() the model, upon which its index is
+     rebuilt.
+
+     Item boxes are enlarged to cover their ports and slider handles,
+     so the boxes are a conservative filter, with the exact test
+     performed on the objects found.
+  */
+  class CanvasIndex
+  {
+  public:
+    SpatialGrid<std::shared_ptr<Item>> items;
+    SpatialGrid<std::shared_ptr<Group>> groups;
+    SpatialGrid<std::shared_ptr<Wire>> wires;
+
+    CanvasIndex() {}
+    /// copies are not attached to any model
+    CanvasIndex(const CanvasIndex&) {}
+    CanvasIndex& operator=(const CanvasIndex&) {return *this;}
+    ~CanvasIndex();
+
+    /// bring the indices up to date with \a model, applying the
+    /// changes recorded since the last update, or rebuilding them if
+    /// the model has been switched or detached from this index
+    void update(const std::shared_ptr<Group>& model);
+    /// detach \a model from its index, if any, which is rebuilt on
+    /// its next update
+    static void detach(Group& model);
+
+    /// @{ record changes to canvas objects. \a owner is the group
+    /// whose wire list holds the wire.
+    static void added(const std::shared_ptr<Item>&);
+    static void added(const std::shared_ptr<Wire>&, const std::weak_ptr<Group>& owner);
+    static void removed(const Item&);
+    static void removed(const Wire&);
+    /// the geometry of an item, and of any wires attached to it or
+    /// group contents, has changed
+    static void moved(const Item&);
+    static void moved(const Wire&);
+    /// @}
+  private:
+    /// a membership change. Objects are weakly referenced, so
+    /// pending changes do not extend their lifetimes.
+    struct Change
+    {
+      enum Type {addItem, addWire, removeItem, removeWire} type;
+      const void* id;
+      std::weak_ptr<Item> item;
+      std::weak_ptr<Wire> wire;
+      std::weak_ptr<Group> owner;
+    };
+    /// changes recorded since the last update
+    std::vector<Change> changes;
+    std::unordered_set<const Item*> movedItems;
+    std::unordered_set<const Wire*> movedWires;
+    /// set when too many changes are pending to be worth applying
+    bool overflow=false;
+
+    /// the model indexed, to which this is attached
+    std::weak_ptr<Group> model;
+
+    /// index attached to the outermost group containing \a i or \a
+    /// w, or nullptr if none
+    static CanvasIndex* observer(const Item& i);
+    static CanvasIndex* observer(const Wire& w);
+    /// calls \a f on the index \a c, if not null, to record a change
+    template <class F> static void record(CanvasIndex* c, F f);
+    bool tooManyChanges() const;
+    void rebuild(const Group& model);
+    bool inModel(const Item&) const;
+    void insert(const std::shared_ptr<Item>&);
+    void insert(const std::shared_ptr<Wire>&, const Group& owner);
+    void eraseItem(const void* id);
+    void relocate(const Item*);
+    void relocate(const Wire*);
+    void relocateWires(const Item&);
+  };
+
+  /// assigns \a y to \a x, a geometric attribute of \a item,
+  /// recording that \a item has moved if that changes \a x
+  template <class T, class U> void setGeometry(const Item& item, T& x, const U& y)
+  {
+    T v=y;
+    if (x!=v)
+      {
+        x=v;
+        CanvasIndex::moved(item);
+      }
+  }
+
+  template <class T>
+  void SpatialGrid<T>::insert(const void* id, const T& obj, const Group* group, float x0, float y0, float x1, float y1)
+  {
+    auto s=slots.find(id);
+    if (s!=slots.end())
+      {
+        auto& e=entries[s->second];
+        e.obj=obj;
+        e.group=group;
+        move(id,x0,y0,x1,y1);
+        return;
+      }
+    slots.emplace(id, entries.size());
+    entries.push_back(Entry{obj,id,group,std::min(x0,x1),std::min(y0,y1),std::max(x0,x1),std::max(y0,y1)});
+    if (built)
+      grid(entries.size()-1);
+  }
+
+  template <class T>
+  void SpatialGrid<T>::move(const void* id, float x0, float y0, float x1, float y1)
+  {
+    auto s=slots.find(id);
+    if (s==slots.end()) return;
+    auto& e=entries[s->second];
+    if (x0>x1) std::swap(x0,x1);
+    if (y0>y1) std::swap(y0,y1);
+    if (built && (cell(x0)!=cell(e.x0) || cell(x1)!=cell(e.x1) ||
+                  cell(y0)!=cell(e.y0) || cell(y1)!=cell(e.y1)))
+      {
+        ungrid(s->second);
+        e.x0=x0; e.y0=y0; e.x1=x1; e.y1=y1;
+        grid(s->second);
+      }
+    else
+      {
+        e.x0=x0; e.y0=y0; e.x1=x1; e.y1=y1;
+      }
+  }
+
+  template <class T> void SpatialGrid<T>::erase(const void* id)
+  {
+    auto s=slots.find(id);
+    if (s==slots.end()) return;
+    unsigned i=s->second;
+    slots.erase(s);
+    if (built) ungrid(i);
+    entries[i].obj=T();
+    // reclaim erased entries once they predominate
+    if (entries.size()>2*slots.size()+64)
+      build();
+  }
+
+  template <class T> void SpatialGrid<T>::grid(unsigned i)
+  {
+    auto& e=entries[i];
+    int i0=cell(e.x0), i1=cell(e.x1), j0=cell(e.y0), j1=cell(e.y1);
+    if (isLarge(i0,i1,j0,j1))
+      insertSorted(large,i);
+    else
+      for (int ii=i0; ii<=i1; ++ii)
+        for (int jj=j0; jj<=j1; ++jj)
+          insertSorted(cells[key(ii,jj)],i);
+  }
+
+  template <class T> void SpatialGrid<T>::ungrid(unsigned i)
+  {
+    auto& e=entries[i];
+    int i0=cell(e.x0), i1=cell(e.x1), j0=cell(e.y0), j1=cell(e.y1);
+    if (isLarge(i0,i1,j0,j1))
+      eraseSorted(large,i);
+    else
+      for (int ii=i0; ii<=i1; ++ii)
+        for (int jj=j0; jj<=j1; ++jj)
+          {
+            auto c=cells.find(key(ii,jj));
+            if (c==cells.end()) continue;
+            eraseSorted(c->second,i);
+            if (c->second.empty())
+              cells.erase(c);
+          }
+  }
+
+  template <class T> void SpatialGrid<T>::build()
+  {
+    cells.clear();
+    large.clear();
+    built=true;
+    // drop erased entries, preserving order
+    if (entries.size()>slots.size())
+      {
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [](const Entry& e){return !e.obj;}),
+                      entries.end());
+        for (unsigned i=0; i<entries.size(); ++i)
+          slots[entries[i].id]=i;
+      }
+    if (entries.empty()) return;
+    // size cells to twice the median object size, so most objects
+    // overlap only a few cells
+    std::vector<float> sizes;
+    for (auto& e: entries)
+      sizes.push_back(std::max(e.x1-e.x0, e.y1-e.y0));
+    std::nth_element(sizes.begin(), sizes.begin()+sizes.size()/2, sizes.end());
+    cellSize=std::max(2*sizes[sizes.size()/2], 1.0f);
+
+    for (unsigned i=0; i<entries.size(); ++i)
+      grid(i);
+  }
+
+  template <class T> template <class C>
+  T SpatialGrid<T>::find(float x, float y, C c) const
+  {
+    static const std::vector<unsigned> empty;
+    auto cl=cells.find(key(cell(x),cell(y)));
+    auto& inCell=cl==cells.end()? empty: cl->second;
+    // merge the cell's entries with the large ones, preserving order
+    auto i=inCell.begin(), j=large.begin();
+    while (i!=inCell.end() || j!=large.end())
+      {
+        unsigned idx;
+        if (j==large.end() || (i!=inCell.end() && *i<*j))
+          idx=*i++;
+        else
+          idx=*j++;
+        auto& e=entries[idx];
+        if (contains(e,x,y) && c(e.obj))
+          return e.obj;
+      }
+    return T();
+  }
+
+  template <class T> template <class F>
+  void SpatialGrid<T>::forEach(float x0, float y0, float x1, float y1, F f) const
+  {
+    if (x0>x1) std::swap(x0,x1);
+    if (y0>y1) std::swap(y0,y1);
+    candidates=large;
+    int i0=cell(x0), i1=cell(x1), j0=cell(y0), j1=cell(y1);
+    if ((i1-i0+1.0)*(j1-j0+1.0)>cells.size())
+      {
+        // cheaper to scan the occupied cells than the region
+        for (auto& c: cells)
+          {
+            int i=int32_t(c.first>>32), j=int32_t(c.first);
+            if (i>=i0 && i<=i1 && j>=j0 && j<=j1)
+              candidates.insert(candidates.end(), c.second.begin(), c.second.end());
+          }
+      }
+    else
+      for (int i=i0; i<=i1; ++i)
+        for (int j=j0; j<=j1; ++j)
+          {
+            auto c=cells.find(key(i,j));
+            if (c!=cells.end())
+              candidates.insert(candidates.end(), c->second.begin(), c->second.end());
+          }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    for (auto idx: candidates)
+      {
+        auto& e=entries[idx];
+        if (e.x1>=x0 && e.x0<=x1 && e.y1>=y0 && e.y0<=y1)
+          f(e);
+      }
+  }
+}
+
+#endif
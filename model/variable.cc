@@ -24,6 +24,7 @@
 #include <error.h>
 #include <ecolab_epilogue.h>
 
+#include <boost/functional/hash.hpp>
 #include <boost/regex.hpp>
 
 using namespace classdesc;
@@ -287,6 +288,17 @@ void VariableBase::adjustSliderBounds() const
   if (sliderMin>value()) sliderMin=value();
 }
 
+size_t VariableBase::displayHash() const
+{
+  auto h=Item::displayHash();
+  boost::hash_combine(h, m_name);
+  boost::hash_combine(h, Slider::sliderVisible);
+  boost::hash_combine(h, sliderMin);
+  boost::hash_combine(h, sliderMax);
+  boost::hash_combine(h, sliderStep);
+  return h;
+}
+
 bool VariableBase::handleArrows(int dir)
 {
   sliderSet(value()+dir*sliderStep);
@@ -412,4 +424,4 @@ void VariablePtr::makeConsistentWithValue()
 }
 
 
-int VarConstant::nextId=0;
+classdesc::Exclude<std::atomic<int>> VarConstant::nextId;
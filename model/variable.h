@@ -25,6 +25,7 @@
 #include <ecolab.h>
 #include <arrays.h>
 
+#include <atomic>
 #include <vector>
 #include <map>
 // override EcoLab's default CLASSDESC_ACCESS macro
@@ -88,6 +89,8 @@ namespace minsky
     const std::string& rawName() const {return m_name;}
     
     bool ioVar() const override;
+    double appearanceValue() const override {return _value();}
+    size_t displayHash() const override;
 
     /// ensure an associated variableValue exists
     void ensureValueExists() const;
@@ -196,7 +199,8 @@ namespace minsky
   struct VarConstant: public Variable<VariableType::constant>
   {
     int id;
-    static int nextId;
+    /// atomic, as models may be constructed concurrently on separate threads
+    static classdesc::Exclude<std::atomic<int>> nextId;
     VarConstant(): id(nextId++) {ensureValueExists();}
     std::string valueId() const override {return "constant:"+str(id);}
     std::string _name() const override {return init();}
@@ -57,6 +57,7 @@ namespace minsky
 
   vector<float> Wire::_coords(const vector<float>& coords)
   {
+    CanvasIndex::moved(*this);
     if (coords.size()<6) 
       m_coords.clear();
     else
@@ -112,6 +113,7 @@ namespace minsky
       t->m_wires.erase(remove(t->m_wires.begin(), t->m_wires.end(), this), t->m_wires.end());
     m_from=from;
     m_to=to;
+    CanvasIndex::moved(*this);
     from->m_wires.push_back(this);
     to->m_wires.push_back(this);
   }
@@ -134,7 +136,10 @@ namespace minsky
           return false;
       }); 
     if (wp)
-      dest.addWire(wp);
+      {
+        CanvasIndex::removed(*wp);
+        dest.addWire(wp);
+      }
   }
 
   void Wire::draw(cairo_t* cairo) const
@@ -18,6 +18,9 @@
 */
 #include "schema2.h"
 #include <ecolab_epilogue.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
 
 namespace classdesc {template <> Factory<minsky::Item,string>::Factory() {}}
 
@@ -61,7 +64,7 @@ namespace schema2
             }
           if (auto d=dynamic_cast<minsky::DataOp*>(i))
             {
-              items.back().dataOpData=d->data;
+              items.back().dataOpData=d->data.toMap();
               items.back().name=d->description;
             }
           if (auto r=dynamic_cast<minsky::RavelWrap*>(i))
@@ -316,22 +319,72 @@ namespace schema2
                   });
   }
       
+  namespace
+  {
+    /// round \a x to the precision it is written to XML with, so
+    /// values differing only beyond that precision become identical
+    template <class T> void roundToSaved(T& x)
+    {
+      char buf[32];
+      snprintf(buf,sizeof(buf),"%g",double(x));
+      x=strtod(buf,nullptr);
+    }
+    template <class T> void roundToSaved(std::vector<T>& x)
+    {for (auto& i: x) roundToSaved(i);}
+    template <class T> void roundToSaved(std::shared_ptr<T>& x)
+    {if (x) roundToSaved(*x);}
+    template <class T> void roundToSaved(Optional<T>& x)
+    {if (x) roundToSaved(*x);}
+  
+    void roundItemToSaved(Item& x)
+    {
+      roundToSaved(x.x); roundToSaved(x.y);
+      roundToSaved(x.zoomFactor); roundToSaved(x.rotation);
+      roundToSaved(x.width); roundToSaved(x.height);
+      roundToSaved(x.iconScale); roundToSaved(x.maxTime);
+      if (x.slider)
+        {
+          roundToSaved(x.slider->min);
+          roundToSaved(x.slider->max);
+          roundToSaved(x.slider->step);
+        }
+    }
+  }
+
+  void Minsky::canonicalise()
+  {
+    for (auto& i: items) roundItemToSaved(i);
+    for (auto& g: groups) roundItemToSaved(g);
+    for (auto& w: wires) roundToSaved(w.coords);
+    for (auto& b: bookmarks)
+      {
+        roundToSaved(b.x); roundToSaved(b.y); roundToSaved(b.zoom);
+      }
+    roundToSaved(zoomFactor);
+  }
+
+  /// assign the simulation parameters and canvas settings of \a y to \a x
+  void populateSettings(minsky::Minsky& x, const Minsky& y)
+  {
+    x.model->setZoom(y.zoomFactor);
+    x.model->bookmarks=y.bookmarks;
+    
+    x.stepMin=y.rungeKutta.stepMin; 
+    x.stepMax=y.rungeKutta.stepMax; 
+    x.nSteps=y.rungeKutta.nSteps;   
+    x.epsAbs=y.rungeKutta.epsAbs;   
+    x.epsRel=y.rungeKutta.epsRel;   
+    x.order=y.rungeKutta.order;
+    x.simulationDelay=y.rungeKutta.simulationDelay;
+    x.implicit=y.rungeKutta.implicit;
+  }
+
   Minsky::operator minsky::Minsky() const
   {
     minsky::Minsky m;
     minsky::LocalMinsky lm(m);
     populateGroup(*m.model);
-    m.model->setZoom(zoomFactor);
-    m.model->bookmarks=bookmarks;
-    
-    m.stepMin=rungeKutta.stepMin; 
-    m.stepMax=rungeKutta.stepMax; 
-    m.nSteps=rungeKutta.nSteps;   
-    m.epsAbs=rungeKutta.epsAbs;   
-    m.epsRel=rungeKutta.epsRel;   
-    m.order=rungeKutta.order;
-    m.simulationDelay=rungeKutta.simulationDelay;
-    m.implicit=rungeKutta.implicit;
+    populateSettings(m, *this);
     return m;
   }
 
@@ -352,7 +405,7 @@ namespace schema2
         if (y.name)
           x1->description=*y.name;
         if (y.dataOpData)
-          x1->data=*y.dataOpData;
+          x1->data=minsky::DataSeries(*y.dataOpData);
       }
     if (auto x1=dynamic_cast<minsky::RavelWrap*>(&x))
       {
@@ -403,6 +456,9 @@ namespace schema2
             x1->legend=true;
             x1->legendSide=*y.legend;
           }
+        if (y.maxSamples) x1->maxSamples=*y.maxSamples;
+        if (y.maxTime) x1->maxTime=*y.maxTime;
+        if (y.spillToDisk) x1->spillToDisk=*y.spillToDisk;
       }
     if (auto x1=dynamic_cast<minsky::SwitchIcon*>(&x))
       {
@@ -428,23 +484,64 @@ namespace schema2
   }
   
   
-  void Minsky::populateGroup(minsky::Group& g) const {
+  /// constructs the contents of a group from schema 2 items, wires
+  /// and groups supplied one at a time. Items are created as they are
+  /// added, retaining only what is needed by finish() to couple
+  /// integrals and attach Godley table variables. Wires and groups
+  /// are not created as they are added, but held in full until
+  /// finish(), so memory used while loading grows with their number.
+  class GroupPopulator
+  {
+  public:
+    GroupPopulator(minsky::Group& g): g(g) {}
+    void addItem(const Item&);
+    /// held until finish(), as integrals may yet replace the ports
+    /// the wire refers to
+    void addWire(const Wire& w) {wires.push_back(w);}
+    /// held until finish(), as the group refers to items by id
+    void addGroup(const Group& g) {groups.push_back(g);}
+    /// complete the group once all items, wires and groups have been added
+    void finish();
+  private:
+    minsky::Group& g;
     map<int, minsky::ItemPtr> itemMap;
     map<int, shared_ptr<minsky::Port>> portMap;
-    map<int, schema2::Item> schema2VarMap;
+    map<int, vector<int>> varPorts;
+    /// integrals and Godley icons, stripped of fields already
+    /// transferred to the created item
+    vector<Item> deferred;
+    vector<Wire> wires;
+    vector<Group> groups;
     MinskyItemFactory factory;
-    
-    for (auto& i: items)
-      if (auto newItem=itemMap[i.id]=g.addItem(factory.create(i.type)))
-        {
-          populateItem(*newItem,i);
-          for (size_t j=0; j<min(newItem->ports.size(), i.ports.size()); ++j)
-            portMap[i.ports[j]]=newItem->ports[j];
-          if (matchesStart(i.type,"Variable:"))
-            schema2VarMap[i.id]=i;
-        }
+  };
+
+  void GroupPopulator::addItem(const Item& i)
+  {
+    if (auto newItem=itemMap[i.id]=g.addItem(factory.create(i.type)))
+      {
+        populateItem(*newItem,i);
+        for (size_t j=0; j<min(newItem->ports.size(), i.ports.size()); ++j)
+          portMap[i.ports[j]]=newItem->ports[j];
+        if (matchesStart(i.type,"Variable:"))
+          varPorts[i.id]=i.ports;
+      }
+    if (((i.type=="IntOp" || i.type=="Operation:integrate") && i.intVar) || i.type=="GodleyIcon")
+      {
+        deferred.emplace_back();
+        auto& d=deferred.back();
+        d.id=i.id;
+        d.type=i.type;
+        d.ports=i.ports;
+        d.intVar=i.intVar;
+        d.height=i.height;
+        d.iconScale=i.iconScale;
+      }
+  }
+
+  void GroupPopulator::finish()
+  {
     // second loop over items to wire up integrals, and populate Godley table variables
-    for (auto& i: items)
+    for (auto& i: deferred)
       {
         if ((i.type=="IntOp" || i.type=="Operation:integrate") && i.intVar)
           {
@@ -458,9 +555,9 @@ namespace schema2
                     g.removeItem(*integ->intVar);
                     integ->intVar=itemMap[*i.intVar];
                   }
-                auto iv=schema2VarMap.find(*i.intVar);
-                if (iv!=schema2VarMap.end())
-                  if ((!i.ports.empty() && i.ports[0]==iv->second.ports[0]) != integ->coupled())
+                auto iv=varPorts.find(*i.intVar);
+                if (iv!=varPorts.end())
+                  if ((!i.ports.empty() && i.ports[0]==iv->second[0]) != integ->coupled())
                     integ->toggleCoupled();
                 // ensure that the correct port is inserted (may have been the deleted intVar)
                 if (!i.ports.empty())
@@ -550,6 +647,243 @@ namespace schema2
           }
       }
   }
+
+  void Minsky::populateGroup(minsky::Group& g) const {
+    GroupPopulator populator(g);
+    for (auto& i: items)
+      populator.addItem(i);
+    for (auto& w: wires)
+      populator.addWire(w);
+    for (auto& i: groups)
+      populator.addGroup(i);
+    populator.finish();
+  }
+
+  namespace
+  {
+    /// splits an XML document read from a stream into markup and
+    /// character data, without building a document tree
+    class XMLTokeniser
+    {
+    public:
+      enum Kind {startTag, endTag, emptyTag, text, other};
+      struct Token
+      {
+        Kind kind;
+        string text; ///< verbatim text of the token
+        string name; ///< element name, for tags
+      };
+
+      XMLTokeniser(istream& input): buf(*input.rdbuf()) {}
+      /// number of characters read so far
+      size_t position() const {return pos;}
+      /// @return false at end of input
+      bool next(Token& t)
+      {
+        t.text.clear();
+        t.name.clear();
+        int c=get();
+        if (c==EOF) return false;
+        t.text+=char(c);
+        if (c!='<')
+          {
+            t.kind=text;
+            while ((c=buf.sgetc())!=EOF && c!='<')
+              t.text+=char(get());
+            return true;
+          }
+
+        // markup
+        readUntil(t.text,'>');
+        if (matchesStart(t.text,"<!--"))
+          {
+            while (t.text.size()<7 || t.text.compare(t.text.size()-3,3,"-->")!=0)
+              readUntil(t.text,'>');
+            t.kind=other;
+          }
+        else if (matchesStart(t.text,"<![CDATA["))
+          {
+            while (t.text.compare(t.text.size()-3,3,"]]>")!=0)
+              readUntil(t.text,'>');
+            t.kind=text;
+          }
+        else if (t.text[1]=='?' || t.text[1]=='!')
+          t.kind=other;
+        else
+          {
+            size_t nameStart=1;
+            if (t.text[1]=='/')
+              {
+                t.kind=endTag;
+                nameStart=2;
+              }
+            else
+              t.kind=t.text[t.text.size()-2]=='/'? emptyTag: startTag;
+            size_t nameEnd=t.text.find_first_of(" \t\r\n/>",nameStart);
+            t.name=t.text.substr(nameStart,nameEnd-nameStart);
+          }
+        return true;
+      }
+
+    private:
+      streambuf& buf;
+      size_t pos=0;
+
+      int get() {
+        int c=buf.sbumpc();
+        if (c!=EOF) ++pos;
+        return c;
+      }
+      /// append characters up to and including \a terminator, skipping
+      /// over quoted attribute values
+      void readUntil(string& s, char terminator)
+      {
+        char quote=0;
+        for (int c=get(); c!=EOF; c=get())
+          {
+            s+=char(c);
+            if (quote)
+              {
+                if (c==quote) quote=0;
+              }
+            else if (c=='"' || c=='\'')
+              quote=c;
+            else if (c==terminator)
+              return;
+          }
+        throw ecolab::error("unexpected end of file");
+      }
+    };
+
+    /// append the element beginning with \a start to \a xml
+    void readElement(XMLTokeniser& tokens, const XMLTokeniser::Token& start, string& xml)
+    {
+      xml+=start.text;
+      if (start.kind!=XMLTokeniser::startTag) return;
+      XMLTokeniser::Token t;
+      for (int depth=1; depth>0;)
+        {
+          if (!tokens.next(t))
+            throw ecolab::error("unexpected end of file in <%s>",start.name.c_str());
+          xml+=t.text;
+          switch (t.kind)
+            {
+            case XMLTokeniser::startTag: ++depth; break;
+            case XMLTokeniser::endTag: --depth; break;
+            default: break;
+            }
+        }
+    }
+
+    template <class T>
+    void unpackElement(const string& xml, const string& name, T& x)
+    {
+      istringstream is(xml);
+      xml_unpack_t unpacker(is);
+      xml_unpack(unpacker, name, x);
+    }
+  }
+
+  bool Minsky::streamLoad(istream& input, minsky::Minsky& m,
+                          const function<void(double)>& progress)
+  {
+    double size=0;
+    if (progress)
+      {
+        auto start=input.tellg();
+        if (start>=0 && input.seekg(0,ios::end))
+          size=input.tellg()-start;
+        input.clear();
+        input.seekg(start);
+      }
+
+    XMLTokeniser tokens(input);
+    XMLTokeniser::Token t;
+    // find the root element
+    do
+      if (!tokens.next(t)) return false;
+    while (t.kind!=XMLTokeniser::startTag);
+    if (t.name!="Minsky") return false;
+
+    // everything apart from the wires, items and groups is
+    // accumulated into a document containing just those elements
+    string header=t.text, xml, collection;
+    bool versionChecked=false;
+    minsky::LocalMinsky lm(m);
+    GroupPopulator populator(*m.model);
+    
+    for (int depth=1; depth>0 && tokens.next(t);)
+      switch (t.kind)
+        {
+        case XMLTokeniser::startTag:
+        case XMLTokeniser::emptyTag:
+          if (depth==1)
+            {
+              if (t.name=="wires" || t.name=="items" || t.name=="groups")
+                {
+                  // schemaVersion precedes the model content
+                  if (!versionChecked) return false;
+                  if (t.kind==XMLTokeniser::startTag)
+                    {
+                      collection=t.name;
+                      depth=2;
+                    }
+                }
+              else
+                {
+                  xml.clear();
+                  readElement(tokens,t,xml);
+                  header+=xml;
+                  if (t.name=="schemaVersion")
+                    {
+                      int schemaVersion=0;
+                      unpackElement(xml, "schemaVersion", schemaVersion);
+                      if (schemaVersion!=Minsky::version) return false;
+                      versionChecked=true;
+                    }
+                }
+            }
+          else
+            {
+              xml.clear();
+              readElement(tokens,t,xml);
+              if (collection=="wires")
+                {
+                  Wire w;
+                  unpackElement(xml, t.name, w);
+                  populator.addWire(w);
+                }
+              else if (collection=="items")
+                {
+                  Item i;
+                  unpackElement(xml, t.name, i);
+                  populator.addItem(i);
+                }
+              else
+                {
+                  Group g;
+                  unpackElement(xml, t.name, g);
+                  populator.addGroup(g);
+                }
+              if (progress && size>0)
+                progress(tokens.position()/size);
+            }
+          break;
+        case XMLTokeniser::endTag:
+          --depth;
+          break;
+        default:
+          break;
+        }
+    if (!versionChecked) return false;
+    populator.finish();
+
+    Minsky settings;
+    unpackElement(header+"</Minsky>", "Minsky", settings);
+    populateSettings(m, settings);
+    if (progress) progress(1);
+    return true;
+  }
 }
 
 
@@ -35,6 +35,8 @@ but any renamed attributes require bumping the schema number.
 #include "rungeKutta.h"
 
 #include <xsd_generate_base.h>
+#include <functional>
+#include <istream>
 #include <vector>
 #include <string>
 
@@ -135,7 +137,10 @@ namespace schema2
     Optional<bool> logx, logy;
     Optional<std::string> xlabel, ylabel, y1label;
     Optional<std::vector<minsky::Bookmark>> bookmarks;
-    std::shared_ptr<ecolab::Plot::Side> legend;
+    Optional<ecolab::Plot::Side> legend;
+    Optional<unsigned> maxSamples;
+    Optional<double> maxTime;
+    Optional<bool> spillToDisk;
 
     Item() {}
     Item(int id, const minsky::Item& it, const std::vector<int>& ports): ItemBase(id,it,ports) {}
@@ -154,8 +159,12 @@ namespace schema2
     Item(int id, const minsky::PlotWidget& p, const std::vector<int>& ports):
       ItemBase(id,static_cast<const minsky::Item&>(p),ports),
       width(p.width), height(p.height), name(p.title), logx(p.logx), logy(p.logy),
-      xlabel(p.xlabel), ylabel(p.ylabel), y1label(p.y1label),
-      legend(p.legend? new ecolab::Plot::Side(p.legendSide): nullptr) {}
+      xlabel(p.xlabel), ylabel(p.ylabel), y1label(p.y1label) {
+      if (p.legend) legend=p.legendSide;
+      if (p.maxSamples) maxSamples=p.maxSamples;
+      if (p.maxTime) maxTime=p.maxTime;
+      if (p.spillToDisk) spillToDisk=true;
+    }
     Item(int id, const minsky::SwitchIcon& s, const std::vector<int>& ports):
       ItemBase(id, static_cast<const minsky::Item&>(s),ports) 
     {if (s.flipped) rotation=180;}
@@ -182,8 +191,11 @@ namespace schema2
     Item(const schema1::Godley& it);
     Item(const schema1::Plot& it):
       ItemBase(it, "PlotWidget"),
-      name(it.title), logx(it.logx), logy(it.logy), xlabel(it.xlabel), ylabel(it.ylabel), y1label(it.y1label),
-      legend(it.legend) {ports=it.ports;}
+      name(it.title), logx(it.logx), logy(it.logy), xlabel(it.xlabel), ylabel(it.ylabel),
+      y1label(it.y1label) {
+      ports=it.ports;
+      if (it.legend) legend=*it.legend;
+    }
     Item(const schema1::Group& it): ItemBase(it,"Group"), name(it.name) {} 
     Item(const schema1::Switch& it): ItemBase(it,"SwitchIcon") {ports=it.ports;} 
 
@@ -253,6 +265,13 @@ namespace schema2
     }
 
     Minsky(const schema1::Minsky& m);
+
+    /// rounds canvas geometry to the precision it is saved with, so
+    /// that models that would save identically also pack to
+    /// identical bytes. Layout arithmetic (eg zooming in and out
+    /// again) leaves differences below that precision, which are not
+    /// changes to the model.
+    void canonicalise();
     
     /// create a Minsky model from this
     operator minsky::Minsky() const;
@@ -260,6 +279,17 @@ namespace schema2
     /// consistent way into the free id space of the global minsky
     /// object
     void populateGroup(minsky::Group& g) const;
+
+    /// Populate \a m from a schema 2 document read from \a input,
+    /// constructing items, wires and groups as their elements are
+    /// read, rather than unpacking the entire document beforehand,
+    /// which bounds the memory required to load large models.
+    /// @param progress if set, is called with the fraction of \a
+    /// input consumed
+    /// @return false if \a input is not a schema 2 document, in
+    /// which case \a m is untouched
+    static bool streamLoad(std::istream& input, minsky::Minsky& m,
+                           const std::function<void(double)>& progress=nullptr);
   };
 
 
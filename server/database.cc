@@ -47,50 +47,222 @@ namespace minsky
 //    }
 //  }
 
-  int Database::createElement(int modelId, schema1::Item& x) 
+  /// statements prepared on one of the pooled sessions, together
+  /// with the variables bound to their parameters and results
+  struct Database::Statements
+  {
+    int modelId=0, id=0, revision=0;
+    string type, data;
+    statement allocateId, selectMaxElem, incrementRevision, selectRevision,
+      insertElement, insertLayout, selectElement, selectLayout,
+      updateElement, updateLayout, deleteElement, deleteLayout, recordDeletion;
+    Statements(session& db):
+      allocateId
+      ((db.prepare << "update models set maxelem=maxelem+1, revision=revision+1 "
+        "where id=:modelId", use(modelId))),
+      selectMaxElem
+      ((db.prepare << "select maxelem, revision from models where id=:modelId",
+        use(modelId), into(id), into(revision))),
+      incrementRevision
+      ((db.prepare << "update models set revision=revision+1 where id=:modelId",
+        use(modelId))),
+      selectRevision
+      ((db.prepare << "select revision from models where id=:modelId",
+        use(modelId), into(revision))),
+      insertElement
+      ((db.prepare << "insert into elements (modelId, id, type, data, revision) "
+        "values (:modelId,:id,:type,:data,:revision)",
+        use(modelId), use(id), use(type), use(data), use(revision))),
+      insertLayout
+      ((db.prepare << "insert into layouts (modelId, id, type, data, revision) "
+        "values (:modelId,:id,:type,:data,:revision)",
+        use(modelId), use(id), use(type), use(data), use(revision))),
+      selectElement
+      ((db.prepare << "select type, data from elements where id=:id and modelId=:modelId",
+        use(id), use(modelId), into(type), into(data))),
+      selectLayout
+      ((db.prepare << "select type, data from layouts where id=:id and modelId=:modelId",
+        use(id), use(modelId), into(type), into(data))),
+      updateElement
+      ((db.prepare << "update elements set type=:type, data=:data, revision=:revision "
+        "where id=:id and modelId=:modelId",
+        use(type), use(data), use(revision), use(id), use(modelId))),
+      updateLayout
+      ((db.prepare << "update layouts set type=:type, data=:data, revision=:revision "
+        "where id=:id and modelId=:modelId",
+        use(type), use(data), use(revision), use(id), use(modelId))),
+      deleteElement
+      ((db.prepare << "delete from elements where id=:id and modelId=:modelId",
+        use(id), use(modelId))),
+      deleteLayout
+      ((db.prepare << "delete from layouts where id=:id and modelId=:modelId",
+        use(id), use(modelId))),
+      recordDeletion
+      ((db.prepare << "insert into deletedelements (modelId, id, revision) "
+        "values (:modelId,:id,:revision)", use(modelId), use(id), use(revision)))
+    {}
+
+    /// increments the revision of model \a m, returning the new
+    /// revision. The update locks the model's row until the enclosing
+    /// transaction completes, so changes to a model are serialised,
+    /// and commit in revision order.
+    int nextRevision(int m)
+    {
+      modelId=m;
+      incrementRevision.execute(true);
+      if (incrementRevision.get_affected_rows()==0)
+        throw error("model %d not found",m);
+      selectRevision.execute(true);
+      return revision;
+    }
+  };
+
+  /// a session checked out of the pool for the lifetime of this object
+  class Database::Connection
+  {
+    Database& database;
+    size_t position;
+  public:
+    session& db;
+    Connection(Database& d):
+      database(d), position(d.connections().lease()), db(d.pool->at(position)) {}
+    ~Connection() {database.pool->give_back(position);}
+    Connection(const Connection&)=delete;
+    void operator=(const Connection&)=delete;
+    /// this session's prepared statements
+    Statements& statements()
+    {
+      auto& s=database.statements[position];
+      if (!s) s.reset(new Statements(db));
+      return *s;
+    }
+  };
+
+  Database::Database() {}
+  Database::Database(const string& conn, size_t poolSize) {openDB(conn, poolSize);}
+  Database::~Database() {}
+
+  void Database::openDB(const string& conn, size_t poolSize)
   {
-    transaction tr(db);
-    int maxItemId;
-    db << "select maxelem from models where id="<<modelId, into(maxItemId);
-    db << "update models set maxelem="<<(++maxItemId)<<" where id="<<modelId;
-    x.id=maxItemId;
+    if (poolSize==0)
+      throw error("database connection pool must not be empty");
+    unique_ptr<connection_pool> newPool(new connection_pool(poolSize));
+    for (size_t i=0; i<poolSize; ++i)
+      newPool->at(i).open(conn);
+    pool.swap(newPool);
+    statements.clear();
+    statements.resize(poolSize);
+    m_poolSize=poolSize;
+  }
 
-    string type=x.type(), data=x.json();
+  connection_pool& Database::connections()
+  {
+    if (!pool)
+      throw error("database not open");
+    return *pool;
+  }
 
-    db << "insert into elements (modelId, id, type, data) "
-      "values (:modelId,:id,:type,:data)",use(modelId),use(maxItemId),use(type),use(data);
+  int Database::createElement(int modelId, schema1::Item& x) 
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    transaction tr(c.db);
+    s.modelId=modelId;
+    // increment first, which locks the model's row until commit, so
+    // concurrent calls allocate distinct ids
+    s.allocateId.execute(true);
+    if (!s.selectMaxElem.execute(true))
+      throw error("model %d not found",modelId);
+    x.id=s.id;
+
+    s.type=x.type(); s.data=x.json();
+    s.insertElement.execute(true);
 
     // insert a default Layout
     UnionLayout l;
-    type=l.type(); data=l.json();
-    db << "insert into layouts (modelId, id, type, data) "
-      "values (:modelId,:id,:type,:data)",use(modelId),use(maxItemId),use(type),use(data);
+    s.type=l.type(); s.data=l.json();
+    s.insertLayout.execute(true);
      
     tr.commit();
-    return maxItemId;
+    return s.revision;
   }
 
   unique_ptr<schema1::Item> Database::readElement(int modelId, int id)
   {
-    string type, elemData;
-    db << "select type, data from elements where id="<<id<<" and modelId="
-       << modelId, into(type), into(elemData);
-    unique_ptr<schema1::Item> r(factory<schema1::Item>(type));
-    r->json(elemData);
+    Connection c(*this);
+    auto& s=c.statements();
+    s.modelId=modelId;
+    s.id=id;
+    if (!s.selectElement.execute(true))
+      throw error("element %d not found in model %d",id,modelId);
+    unique_ptr<schema1::Item> r(factory<schema1::Item>(s.type));
+    r->json(s.data);
     return r;
   }
 
-  void Database::updateElement(int modelId, const schema1::Item& x) {}
+  int Database::updateElement(int modelId, const schema1::Item& x)
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    transaction tr(c.db);
+    s.nextRevision(modelId);
+    s.id=x.id; s.type=x.type(); s.data=x.json();
+    s.updateElement.execute(true);
+    if (s.updateElement.get_affected_rows()==0)
+      throw error("element %d not found in model %d",x.id,modelId);
+    tr.commit();
+    return s.revision;
+  }
 
-  void Database::deleteElement(int modelId, const schema1::Item& x) {}
+  int Database::deleteElement(int modelId, const schema1::Item& x)
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    transaction tr(c.db);
+    s.nextRevision(modelId);
+    s.id=x.id;
+    s.deleteElement.execute(true);
+    if (s.deleteElement.get_affected_rows()==0)
+      throw error("element %d not found in model %d",x.id,modelId);
+    s.deleteLayout.execute(true);
+    s.recordDeletion.execute(true);
+    tr.commit();
+    return s.revision;
+  }
 
   unique_ptr<Layout> Database::readLayout(int modelId, int id) 
-  {return unique_ptr<Layout>();}
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    s.modelId=modelId;
+    s.id=id;
+    if (!s.selectLayout.execute(true))
+      throw error("layout %d not found in model %d",id,modelId);
+    unique_ptr<Layout> r(factory<Layout>(s.type));
+    r->json(s.data);
+    r->id=id;
+    return r;
+  }
 
-  void Database::updateLayout(int modelId, const Layout& x) {}
+  int Database::updateLayout(int modelId, const Layout& x)
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    transaction tr(c.db);
+    s.nextRevision(modelId);
+    s.id=x.id; s.type=x.type(); s.data=x.json();
+    s.updateLayout.execute(true);
+    if (s.updateLayout.get_affected_rows()==0)
+      throw error("layout %d not found in model %d",x.id,modelId);
+    tr.commit();
+    return s.revision;
+  }
    
   namespace
   {
+    /// rows transferred per round trip by bulk selects
+    const size_t fetchChunk=1000;
+
     // copy a vector into a base polymorphic vector, where T is a subclass of B
     template <class T>
     void moveInto(vector<int>& ids, vector<string>& types, 
@@ -98,13 +270,43 @@ namespace minsky
     {
       for (typename vector<T>::const_iterator i=y.begin(); i!=y.end(); ++i)
         {
-          const T& ii=*i;
           ids.push_back(i->id);
           types.push_back(i->typeName());
           data.push_back(i->json());
         }
       y.clear();
     }
+
+    /// appends \a x to \a y if \a x is a T, returning true if so
+    template <class T>
+    bool addTo(vector<T>& y, const Item& x)
+    {
+      if (const T* t=dynamic_cast<const T*>(&x))
+        {
+          y.push_back(*t);
+          return true;
+        }
+      return false;
+    }
+
+    /// appends the rows of \a table in model \a modelId changed after
+    /// \a revision to \a changes
+    void readChanges(session& db, const string& table, int modelId, int revision,
+                     vector<ElementData>& changes)
+    {
+      vector<int> ids(fetchChunk);
+      vector<string> type(fetchChunk), data(fetchChunk);
+      statement st=(db.prepare << "select id, type, data from "<<table<<
+                    " where modelid=:modelId and revision>:revision",
+                    use(modelId), use(revision), into(ids), into(type), into(data));
+      st.execute();
+      while (st.fetch())
+        {
+          for (size_t i=0; i<ids.size(); ++i)
+            changes.emplace_back(ids[i], type[i], data[i]);
+          ids.resize(fetchChunk); type.resize(fetchChunk); data.resize(fetchChunk);
+        }
+    }
   }
 
 
@@ -115,10 +317,12 @@ namespace minsky
     vector<string> elementType, elementData, layoutType, layoutData;
     vector<int> ids;
     moveInto(ids, elementType, elementData, m.model.wires);
+    moveInto(ids, elementType, elementData, m.model.notes);
     moveInto(ids, elementType, elementData, m.model.operations);
     moveInto(ids, elementType, elementData, m.model.variables);
     moveInto(ids, elementType, elementData, m.model.plots);
     moveInto(ids, elementType, elementData, m.model.groups);
+    moveInto(ids, elementType, elementData, m.model.switches);
     moveInto(ids, elementType, elementData, m.model.godleys);
 
     if (elementData.empty())
@@ -146,52 +350,102 @@ namespace minsky
       else
         {
           layoutType.push_back(UnionLayout().type());
-          layoutType.push_back(UnionLayout().json());
+          layoutData.push_back(UnionLayout().json());
         }
 
     int modelId;
     string modelData=json(m);
-    indicator ind;
-    transaction tr(db);
-    db << "insert into models (name, owner, maxelem, data) values ('"<< 
-      name <<"','"<< owner <<"',"<< maxElementId <<",:modelData)",use(modelData); 
-    // retrieve automatically allocated modelId
-    db << "select max(id) from models",into(modelId);
-    db << "insert into elements (modelid, id, type, data) values ("
-       <<modelId<<", :id, :type, :data)",
-      use(ids), use(elementType),use(elementData);
-    if (!layoutData.empty())
-      db << "insert into layouts (modelid, id, type, data) values ("<<
-        modelId << ", :id, :type, :data)",
-        use(ids), use(layoutType),use(layoutData);
+    Connection c(*this);
+    transaction tr(c.db);
+    // retrieve the automatically allocated modelId from the insert
+    // itself, or this session's last insert, so that concurrent
+    // creations, from this or any other process, each get their own
+    if (c.db.get_backend_name()=="postgresql")
+      c.db << "insert into models (name, owner, maxelem, data) "
+        "values (:name, :owner, :maxelem, :data) returning id",
+        use(name), use(owner), use(maxElementId), use(modelData), into(modelId);
+    else
+      {
+        c.db << "insert into models (name, owner, maxelem, data) "
+          "values (:name, :owner, :maxelem, :data)",
+          use(name), use(owner), use(maxElementId), use(modelData);
+        if (c.db.get_backend_name()=="sqlite3")
+          c.db << "select last_insert_rowid()", into(modelId);
+        else
+          c.db << "select last_insert_id()", into(modelId);
+      }
+
+    // elements and layouts are each inserted in a single bulk
+    // statement, rather than a round trip per row
+    vector<int> modelIds(ids.size(), modelId);
+    c.db << "insert into elements (modelid, id, type, data) "
+      "values (:modelId, :id, :type, :data)",
+      use(modelIds), use(ids), use(elementType), use(elementData);
+    c.db << "insert into layouts (modelid, id, type, data) "
+      "values (:modelId, :id, :type, :data)",
+      use(modelIds), use(ids), use(layoutType), use(layoutData);
 
     tr.commit();
     return modelId;
   }
 
-  void Database::readModel(int modelId, schema1::Minsky& model) 
+  int Database::readModel(int modelId, schema1::Minsky& model) 
   {
     string modelData;
-    db << "select data from models where id="<<modelId, into(modelData);
+    int revision;
+    Connection c(*this);
+    // the revision is read first, so that any changes made while the
+    // elements are read are reported to a subsequent changesSince
+    c.db << "select data, revision from models where id=:modelId",
+      use(modelId), into(modelData), into(revision);
+    if (!c.db.got_data())
+      throw error("model %d not found",modelId);
     json(model, modelData);
 
     // retrieve elements
-    int count;
-    db << "select count(id) from elements where modelid="<<modelId,into(count);
-    vector<string> type(count), data(count);
-    db << "select type,data from elements where modelid="<<modelId, into(type), into(data);
+    vector<string> type(fetchChunk), data(fetchChunk);
+    {
+      statement st=(c.db.prepare << "select type, data from elements where modelid=:modelId",
+                    use(modelId), into(type), into(data));
+      st.execute();
+      while (st.fetch())
+        {
+          MinskyModel& m=model.model;
+          for (size_t i=0; i<type.size(); ++i)
+            {
+              unique_ptr<schema1::Item> r(factory<schema1::Item>(type[i]));
+              r->json(data[i]);
+              addTo(m.wires, *r) || addTo(m.operations, *r) ||
+                addTo(m.variables, *r) || addTo(m.plots, *r) ||
+                addTo(m.groups, *r) || addTo(m.switches, *r) ||
+                addTo(m.godleys, *r) || addTo(m.notes, *r);
+            }
+          // fetch shrinks the vectors to the rows retrieved
+          type.resize(fetchChunk); data.resize(fetchChunk);
+        }
+    }
 
-    for (size_t i=0; i<type.size(); ++i)
+    // retrieve layouts. These need their own vectors, as the element
+    // fetch above has shrunk type and data to the last chunk's size,
+    // and soci requires all bulk into elements to be the same size
+    vector<int> ids(fetchChunk);
+    vector<string> layoutType(fetchChunk), layoutData(fetchChunk);
+    statement st=(c.db.prepare << "select id, type, data from layouts where modelid=:modelId",
+                  use(modelId), into(ids), into(layoutType), into(layoutData));
+    st.execute();
+    while (st.fetch())
       {
-        unique_ptr<schema1::Item> r(factory<schema1::Item>(type[i]));
-        r->json(data[i]);
-        if (schema1::Operation* op=dynamic_cast<schema1::Operation*>(r.get()))
-          model.model.operations.push_back(*op);
-        // TODO: the other types
+        for (size_t i=0; i<ids.size(); ++i)
+          {
+            shared_ptr<Layout> l(factory<Layout>(layoutType[i]));
+            l->json(layoutData[i]);
+            l->id=ids[i];
+            model.layout.push_back(l);
+          }
+        ids.resize(fetchChunk);
+        layoutType.resize(fetchChunk); layoutData.resize(fetchChunk);
       }
-
-    // TODO: layouts
-
+    return revision;
   }
   void Database::updateModel(int modelId, const schema1::Minsky&) {}
   void Database::deleteModel(int modelId) {}
@@ -200,15 +454,54 @@ namespace minsky
   void Database::listModels(const string& user, ModelList& models)
   {
     // TODO - select based on user field and shares
-    // bloody soci requires presizing the input vectors! grrrr
-    unsigned count;
-    db << "select count(id) from models",into(count);
-    if (count==0) return;
-    vector<int> ids(count);
-    vector<string> names(count);
-    db << "select id, name from models",into(ids),into(names);
-    for (size_t i=0; i<ids.size(); ++i)
-      models.push_back(ModelDescriptor(ids[i], names[i], false));
+    Connection c(*this);
+    vector<int> ids(fetchChunk);
+    vector<string> names(fetchChunk);
+    statement st=(c.db.prepare << "select id, name from models",into(ids),into(names));
+    st.execute();
+    while (st.fetch())
+      {
+        for (size_t i=0; i<ids.size(); ++i)
+          models.push_back(ModelDescriptor(ids[i], names[i], false));
+        ids.resize(fetchChunk); names.resize(fetchChunk);
+      }
   }
 
+  int Database::revision(int modelId)
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    s.modelId=modelId;
+    if (!s.selectRevision.execute(true))
+      throw error("model %d not found",modelId);
+    return s.revision;
+  }
+
+  int Database::changesSince(int modelId, int revision, ModelChanges& changes)
+  {
+    Connection c(*this);
+    auto& s=c.statements();
+    s.modelId=modelId;
+    // as with readModel, read the current revision first. Rows changed
+    // after this are also returned, and will be returned again by the
+    // next call, which is harmless as applying a change is idempotent.
+    if (!s.selectRevision.execute(true))
+      throw error("model %d not found",modelId);
+    int current=s.revision;
+    if (current<=revision) return current;
+
+    readChanges(c.db, "elements", modelId, revision, changes.elements);
+    readChanges(c.db, "layouts", modelId, revision, changes.layouts);
+    vector<int> ids(fetchChunk);
+    statement st=(c.db.prepare << "select id from deletedelements "
+                  "where modelid=:modelId and revision>:revision",
+                  use(modelId), use(revision), into(ids));
+    st.execute();
+    while (st.fetch())
+      {
+        changes.deleted.insert(changes.deleted.end(), ids.begin(), ids.end());
+        ids.resize(fetchChunk);
+      }
+    return current;
+  }
 }
@@ -20,43 +20,73 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 #include <soci/soci.h>
+#include <soci/connection-pool.h>
 #include "schema/schema1.h"
 #include "message.h"
+#include <memory>
+#include <vector>
 
 namespace minsky
 {
+  /// Database access is thread-safe. Each call checks a session out of
+  /// a pool of connections for its duration, so as many calls as
+  /// there are connections can proceed concurrently. Per element
+  /// statements are prepared once per session, and whole models are
+  /// transferred with bulk statements.
+  ///
+  /// Each model has a revision, incremented by every change to its
+  /// elements or layouts, and each element and layout records the
+  /// revision at which it last changed, so clients can retrieve just
+  /// the changes made since the revision they have.
   class Database
   {
-    soci::session db;
+    std::unique_ptr<soci::connection_pool> pool;
+    size_t m_poolSize=0;
+    soci::connection_pool& connections();
+    /// prepared statements, created on first use of each pooled session
+    struct Statements;
+    std::vector<std::unique_ptr<Statements>> statements;
+    class Connection;
   public:
-    Database(const std::string& conn): db(conn) {}
-    Database() {}
-    void openDB(const std::string& conn) {db.open(conn);}
-    /// creates element (initialised to \a x), returning item ID
+    Database(const std::string& conn, size_t poolSize=1);
+    Database();
+    ~Database();
+    /// open \a poolSize connections to the database described by \a conn
+    void openDB(const std::string& conn, size_t poolSize=1);
+    size_t poolSize() const {return m_poolSize;}
+    /// creates element (initialised to \a x), setting x.id to the
+    /// allocated item ID, and returning the model's new revision
     int createElement(int modelId, schema1::Item& x);
     /// reads element from database, using id as key
     unique_ptr<schema1::Item> readElement(int modelId, int id); 
-    /// updates database element with \a x
-    void updateElement(int modelId, const schema1::Item& x);
-    /// removes database element for \a x
-    void deleteElement(int modelId, const schema1::Item& x);
+    /// updates database element with \a x, returning the model's new revision
+    int updateElement(int modelId, const schema1::Item& x);
+    /// removes database element for \a x, returning the model's new revision
+    int deleteElement(int modelId, const schema1::Item& x);
 
    /// NB no create or delete operations provided for Layouts, as the item
     /// versions perform these 
 
     /// reads layout element from database, using id as key
     unique_ptr<schema1::Layout> readLayout(int modelId, int id);
-    /// updates database layout element with \a x
-    void updateLayout(int modelId, const schema1::Layout& x);
+    /// updates database layout element with \a x, returning the
+    /// model's new revision
+    int updateLayout(int modelId, const schema1::Layout& x);
  
     int createModel(const string& name, const string& owner, schema1::Minsky);
-    void readModel(int modelId, schema1::Minsky&);
+    /// reads a model, returning the revision read
+    int readModel(int modelId, schema1::Minsky&);
     void updateModel(int modelId, const schema1::Minsky&);
     void deleteModel(int modelId);
 
     /// return a list of models available to \a user
     void listModels(const string& user, ModelList& models);
 
+    /// current revision of a model
+    int revision(int modelId);
+    /// retrieves the changes made to a model after \a revision,
+    /// returning the revision they bring the model up to
+    int changesSince(int modelId, int revision, ModelChanges& changes);
   }; 
 }
 
@@ -56,7 +56,7 @@ namespace minsky
           {
             MsgPPtr<schema1::Item> r(msg);
             r.setPayload(p->cloneT<schema1::Item>());
-            db.createElement(r.modelId, *r.payload);
+            r.revision=db.createElement(r.modelId, *r.payload);
             client.send(r);
             return;
           }
@@ -65,8 +65,8 @@ namespace minsky
         // TODO check user is able to do this!
         if (const Msg<Minsky>* m=dynamic_cast<const Msg<Minsky>*>(&msg))
           {
-            Msg<Minsky> r;
-            db.readModel(m->modelId, r.payload);
+            Msg<Minsky> r(msg);
+            r.revision=db.readModel(m->modelId, r.payload);
             client.send(r);
             return;
           }
@@ -80,11 +80,47 @@ namespace minsky
         if (const Layout* p=dynamic_cast<const Layout*>(msg.payloadAsPolyBase()))
           {
             MsgPPtr<Layout> r(msg);
-            r.setPayload(db.readLayout(r.modelId, r.payload->id).release());
+            r.setPayload(db.readLayout(r.modelId, p->id).release());
             client.send(r);
             return;
           }
         break;
+      case update:
+        if (auto p=dynamic_cast<const schema1::Item*>(msg.payloadAsPolyBase()))
+          {
+            MsgPPtr<schema1::Item> r(msg);
+            r.setPayload(p->cloneT<schema1::Item>());
+            r.revision=db.updateElement(r.modelId, *r.payload);
+            client.send(r);
+            return;
+          }
+        if (auto p=dynamic_cast<const Layout*>(msg.payloadAsPolyBase()))
+          {
+            MsgPPtr<Layout> r(msg);
+            r.setPayload(p->cloneT<Layout>());
+            r.revision=db.updateLayout(r.modelId, *r.payload);
+            client.send(r);
+            return;
+          }
+        break;
+      case del:
+        if (auto p=dynamic_cast<const schema1::Item*>(msg.payloadAsPolyBase()))
+          {
+            MsgPPtr<schema1::Item> r(msg);
+            r.setPayload(p->cloneT<schema1::Item>());
+            r.revision=db.deleteElement(r.modelId, *r.payload);
+            client.send(r);
+            return;
+          }
+        break;
+      case changes:
+        // elements changed since the revision the client has
+        {
+          Msg<ModelChanges> r(msg);
+          r.revision=db.changesSince(msg.modelId, msg.revision, r.payload);
+          client.send(r);
+          return;
+        }
       case listModels:
         {
           Msg<ModelList> r;
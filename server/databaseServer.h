@@ -30,7 +30,11 @@ namespace minsky
   {
   public:
     Exclude<Database> db;
-    void openDb(const std::string& conn) {db.openDB(conn);}
+    /// open a connection to the database for each thread that may
+    /// process requests. Set the thread counts before calling this.
+    void openDb(const std::string& conn)
+    {db.openDB(conn, requestThreads());}
+    ~DatabaseServer() {stop();}
     void onMessage(const Client& client, const MsgBase& msg);
     /// load model given by \a filename into the database
     void load(const string& filename);
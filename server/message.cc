@@ -20,6 +20,7 @@
 #include "message.h"
 #include "schema1.h"
 #include <ecolab_epilogue.h>
+#include <stdint.h>
 
 namespace classdesc
 {
@@ -48,6 +49,47 @@ namespace minsky
     return typeName.substr(p);
   }
 
+  namespace
+  {
+    const size_t lengthSize=4;
+  }
+
+  string MsgBase::binary() const
+  {
+    pack_t b;
+    b<<typeName();
+    pack(b);
+    uint32_t n=b.size();
+    if (n!=b.size())
+      throw error("message too large to encode");
+    string r(lengthSize,'\0');
+    for (size_t i=0; i<lengthSize; ++i)
+      r[i]=(n>>(8*i))&0xFF;
+    r.append(b.data(), b.size());
+    return r;
+  }
+
+  unique_ptr<MsgBase> MsgFactory::decode(const string& frame) const
+  {
+    uint32_t n=0;
+    if (frame.size()>=lengthSize)
+      for (size_t i=0; i<lengthSize; ++i)
+        n|=uint32_t(static_cast<unsigned char>(frame[i]))<<(8*i);
+    if (frame.size()<lengthSize || frame.size()-lengthSize!=n)
+      throw error("malformed binary message");
+    unpack_t b;
+    b.packraw(frame.data()+lengthSize, n);
+    string payloadClass;
+    b>>payloadClass;
+    unique_ptr<MsgBase> r;
+    if (payloadClass.empty())
+      r.reset(new Msg<NoPayload>);
+    else
+      r.reset(create(suppressSchema(payloadClass)));
+    r->unpack(b);
+    return r;
+  }
+
   MsgFactory msgFactory;
 
 }
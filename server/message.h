@@ -20,14 +20,16 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H
 #include "json_pack_base.h"
+#include "pack_base.h"
 #include "classdesc_access.h"
 #include "factory.h"
 #include "polyBase.h"
+#include <memory>
 
 struct MsgType
 {
   enum Type {invalid, create, read, update, del, listModels, 
-             version, commands, payloads, defaultPayload};
+             version, commands, payloads, defaultPayload, changes, stats};
 }; 
 
 namespace minsky
@@ -38,9 +40,20 @@ namespace minsky
   {
     Type msg;
     int modelId;
-    MsgBase(): msg(invalid), modelId(-1) {}
+    /// revision of the model that this message reflects, where
+    /// known. For a changes request, the revision the client already has.
+    int revision;
+    MsgBase(): msg(invalid), modelId(-1), revision(-1) {}
     virtual string json() const=0;
     virtual void json(const string&)=0;
+    /// binary encoding, used by clients that support it instead of
+    /// JSON. A frame consists of the length of the remainder of the
+    /// frame as a 32 bit little endian integer, then the payload class
+    /// and the message packed with pack_t, in the sender's native byte
+    /// order.
+    string binary() const;
+    virtual void pack(pack_t&) const=0;
+    virtual void unpack(unpack_t&)=0;
     virtual string typeName() const=0;
     virtual ~MsgBase() {}
     /// returns payload type cast to a PolyBase, or NULL if payload not
@@ -72,6 +85,8 @@ namespace minsky
       json_spirit::read(s, j);
       json_unpack(j,"",*this);
     }
+    void pack(pack_t& b) const {::pack(b,"",*this);}
+    void unpack(unpack_t& b) {::unpack(b,"",*this);}
     string typeName() const {return payloadClass;}
 
     // even though technically, Payload could be a poly type, and can
@@ -120,6 +135,14 @@ namespace minsky
       json_unpack(j,"",*this);
       payload->json_unpack(j,".payload");
     }
+    void pack(pack_t& b) const {
+      ::pack(b,"",*this);
+      payload->pack(b,".payload");
+    }
+    void unpack(unpack_t& b) {
+      ::unpack(b,"",*this);
+      payload->unpack(b,".payload");
+    }
     string typeName() const {return payloadClass;}
 
     //assumes this class is only used with PolyBase derived types
@@ -134,6 +157,9 @@ namespace minsky
   public:
     using Factory<MsgBase, string>::registerType;
     MsgFactory();
+    /// decodes a frame produced by MsgBase::binary(). Messages without
+    /// a payload are returned as a Msg<NoPayload>
+    std::unique_ptr<MsgBase> decode(const string& frame) const;
     // for enumerate... registration
     template <class T> void registerType() {
       Factory<MsgBase, string>::registerType<MsgPPtr<T> >
@@ -154,16 +180,51 @@ namespace minsky
     ModelDescriptor() {}
   };
 
+  /// payload of messages consisting of just a header
+  struct NoPayload {};
+
   /// return value of version call
   struct Version
   {
     int schemaVersion;
     string minskyVersion, ecolabVersion;
+    /// message encodings the server accepts, and replies in
+    std::vector<string> encodings{"json","binary"};
   };
 
 
   typedef std::vector<ModelDescriptor> ModelList;
 
+  /// return value of the stats call. Latencies are in microseconds,
+  /// from receipt of a request to the end of its processing.
+  struct LatencyStats
+  {
+    size_t requests=0; ///< number of requests processed
+    size_t queued=0;   ///< number of requests waiting for a worker thread
+    double p50=0, p90=0, p99=0, p999=0, max=0; ///< latency percentiles
+  };
+
+  /// an element or layout, as stored in the database
+  struct ElementData
+  {
+    int id;
+    string type;
+    string data; ///< JSON serialisation of the element
+    ElementData(int id, const string& type, const string& data):
+      id(id), type(type), data(data) {}
+    ElementData(): id(-1) {}
+  };
+
+  /// return value of the changes call: the elements and layouts
+  /// created or updated, and the ids of elements deleted, since the
+  /// revision given in the request. The reply's revision field gives
+  /// the revision these changes bring the model up to.
+  struct ModelChanges
+  {
+    std::vector<ElementData> elements, layouts;
+    std::vector<int> deleted;
+  };
+
 }
 
 #ifdef _CLASSDESC
@@ -178,12 +239,18 @@ namespace minsky
 
 #pragma omit json_pack minsky::PayloadPtr
 #pragma omit json_unpack minsky::PayloadPtr
+#pragma omit pack minsky::PayloadPtr
+#pragma omit unpack minsky::PayloadPtr
 #endif
 
 template <class T>
 void json_pack(classdesc::json_pack_t&,const classdesc::string&,minsky::PayloadPtr<T>&) {}
 template <class T>
 void json_unpack(classdesc::json_unpack_t&,const classdesc::string&,minsky::PayloadPtr<T>&) {}
+template <class T>
+void pack(classdesc::pack_t&,const classdesc::string&,minsky::PayloadPtr<T>&) {}
+template <class T>
+void unpack(classdesc::unpack_t&,const classdesc::string&,minsky::PayloadPtr<T>&) {}
 
 #include "message.xcd"
 #include "message.cd"
@@ -32,7 +32,23 @@ CREATE TABLE IF NOT EXISTS `elements` (
   `id` int(11) NOT NULL,
   `type` varchar(255) NOT NULL,
   `data` text NOT NULL,
-  PRIMARY KEY (`modelid`,`id`)
+  `revision` int(11) NOT NULL DEFAULT 0,
+  PRIMARY KEY (`modelid`,`id`),
+  KEY `revision` (`modelid`,`revision`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+-- --------------------------------------------------------
+
+--
+-- Table structure for table `deletedelements`
+--
+
+DROP TABLE IF EXISTS `deletedelements`;
+CREATE TABLE IF NOT EXISTS `deletedelements` (
+  `modelid` int(11) NOT NULL,
+  `id` int(11) NOT NULL,
+  `revision` int(11) NOT NULL,
+  KEY `revision` (`modelid`,`revision`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
 
 -- --------------------------------------------------------
@@ -47,7 +63,9 @@ CREATE TABLE IF NOT EXISTS `layouts` (
   `id` int(11) NOT NULL,
   `type` varchar(255) NOT NULL,
   `data` text NOT NULL,
-  PRIMARY KEY (`modelid`,`id`)
+  `revision` int(11) NOT NULL DEFAULT 0,
+  PRIMARY KEY (`modelid`,`id`),
+  KEY `revision` (`modelid`,`revision`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
 
 -- --------------------------------------------------------
@@ -63,6 +81,7 @@ CREATE TABLE IF NOT EXISTS `models` (
   `owner` varchar(255) NOT NULL,
   `maxelem` int(11) NOT NULL,
   `data` text NOT NULL,
+  `revision` int(11) NOT NULL DEFAULT 0,
   PRIMARY KEY (`id`),
   UNIQUE KEY `id` (`id`)
 ) ENGINE=InnoDB  DEFAULT CHARSET=utf8 AUTO_INCREMENT=3 ;
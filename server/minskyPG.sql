@@ -22,12 +22,26 @@ CREATE TABLE elements (
     modelid integer NOT NULL,
     id integer NOT NULL,
     type character varying,
-    data text
+    data text,
+    revision integer DEFAULT 0 NOT NULL
 );
 
 
 ALTER TABLE public.elements OWNER TO postgres;
 
+--
+-- Name: deletedelements; Type: TABLE; Schema: public; Owner: postgres; Tablespace: 
+--
+
+CREATE TABLE deletedelements (
+    modelid integer NOT NULL,
+    id integer NOT NULL,
+    revision integer NOT NULL
+);
+
+
+ALTER TABLE public.deletedelements OWNER TO postgres;
+
 --
 -- Name: layouts; Type: TABLE; Schema: public; Owner: postgres; Tablespace: 
 --
@@ -36,7 +50,8 @@ CREATE TABLE layouts (
     modelid integer NOT NULL,
     id integer NOT NULL,
     type character varying,
-    data text
+    data text,
+    revision integer DEFAULT 0 NOT NULL
 );
 
 
@@ -51,7 +66,8 @@ CREATE TABLE models (
     name character varying(255),
     owner character varying(255),
     maxelem integer,
-    data text
+    data text,
+    revision integer DEFAULT 0 NOT NULL
 );
 
 
@@ -101,6 +117,27 @@ ALTER TABLE ONLY models
     ADD CONSTRAINT models_pkey PRIMARY KEY (id);
 
 
+--
+-- Name: elements_revision; Type: INDEX; Schema: public; Owner: postgres; Tablespace: 
+--
+
+CREATE INDEX elements_revision ON elements USING btree (modelid, revision);
+
+
+--
+-- Name: layouts_revision; Type: INDEX; Schema: public; Owner: postgres; Tablespace: 
+--
+
+CREATE INDEX layouts_revision ON layouts USING btree (modelid, revision);
+
+
+--
+-- Name: deletedelements_revision; Type: INDEX; Schema: public; Owner: postgres; Tablespace: 
+--
+
+CREATE INDEX deletedelements_revision ON deletedelements USING btree (modelid, revision);
+
+
 --
 -- Name: public; Type: ACL; Schema: -; Owner: postgres
 --
@@ -5,6 +5,10 @@
 # or
 #   set connection "mysql://db=minsky user=xxx password=yyy"
 source $env(HOME)/minskyConnect.tcl
+# the database connection pool is sized to the number of threads
+# processing requests, so set these before opening the database
+databaseServer.listenerThreads 2
+databaseServer.workerThreads 4
 databaseServer.openDb $connection
 
 #if argv(1) has .tcl extension, it is a script, otherwise it is data
@@ -17,7 +21,5 @@ if {$argc>1} {
 	}
 }
 
-databaseServer.listenerThreads 0
-databaseServer.workerThreads 0
 databaseServer.port 8000
 databaseServer.start
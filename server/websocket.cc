@@ -18,29 +18,23 @@
 */
 
 #include "websocket.h"
+#include "workQueue.h"
 //#include <websocketpp/websocketpp.hpp>
 #include <boost/thread/thread.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
+#include <boost/chrono.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
 
 //using namespace websocketpp;
 using namespace boost;
 using namespace std;
 
-namespace
-{
-  // dummy type used for unpacking just the message headers
-  struct Dummy {};
-}
-
-//namespace classdesc
-//{
-//  // set dummy type to "", meaning that an unspecified payloadClass gets this object
-//  template <> string typeName<Dummy>() {return "";}
-//  template <> void json_pack(json_pack_t&, const string&, Dummy&) {}
-//  template <> void json_unpack(json_pack_t&, const string&, Dummy&) {}
-//}
-
 #include "ecolab_epilogue.h"
 
 namespace minsky
@@ -50,94 +44,69 @@ namespace minsky
     class ClientImpl//: private server::handler::connection_ptr
     {
     public:
-//      ClientImpl(const server::handler::connection_ptr& con): 
-//        server::handler::connection_ptr(con) {}
+      /// true if replies are binary encoded, as the request was
+      bool binary=false;
+//      ClientImpl(const server::handler::connection_ptr& con, bool binary): 
+//        server::handler::connection_ptr(con), binary(binary) {}
       void send(const MsgBase& msg) const {
-        //        (*this)->send(msg.json());
+        //        if (binary)
+        //          (*this)->send(msg.binary(), frame::opcode::BINARY);
+        //        else
+        //          (*this)->send(msg.json());
       }
     };
 
     struct Request
     {
       Websocket::Client client;
+      /// message, either JSON or binary encoded
       string msgJson;
-      Request(ClientImpl* client, const string& msgJson): 
-        client(client), msgJson(msgJson) {}
+      bool binary=false;
+      /// time of receipt, for measuring latency
+      std::chrono::steady_clock::time_point received;
+      Request(ClientImpl* client, const string& msgJson, bool binary=false): 
+        client(client), msgJson(msgJson), binary(binary),
+        received(std::chrono::steady_clock::now()) {}
       Request() {}
     };
 
-
-    // The coordinator is a simple wrapper around an STL queue.
-    // add_request inserts a new request. get_request returns the next
-    // available request and blocks (using condition variables) in the
-    // case that the queue is empty.
-    class RequestCoordinator {
-    public:
-      void add_request(const Request& r) {
-        unique_lock<mutex> lock(m_lock);
-        //        m_requests.push(r);
-        lock.unlock();
-        m_cond.notify_one();
-      }
-      
-      void get_request(Request& value) {
-        //        boost::unique_lock<boost::mutex> lock(m_lock);
-        
-//        while (m_requests.empty()) {
-//          m_cond.wait(lock);
-//        }
-        
-//        value = m_requests.front();
-//        m_requests.pop();
-      }
-    private:
-      //      queue<Request>         m_requests;
-      mutex                m_lock;
-      condition_variable   m_cond;
-    };
-
-#if 0 // disable websocket
-    class Impl: public server::handler
-    {
-      Websocket& intf; // interface to handle callbacks
-      RequestCoordinator req;
-      // shared_ptr, because thread is non-copiable
-      vector<classdesc::shared_ptr<thread> > threads;
-      void on_message(connection_ptr con, message_ptr msg); 
-      void process(const Request& r);
-      volatile bool running;
-      classdesc::shared_ptr<barrier> terminated;
-    public:
-      Impl(Websocket& intf): intf(intf), running(false) {}
-      void start(unsigned workerThreads);
-      void threadRoutine();
-      ~Impl();
-    };
-
-
-    void Impl::on_message(connection_ptr con,message_ptr msg)
-    {
-      Request r(new ClientImpl(con), msg->get_payload());
-      if (threads.empty())
-        process(r);
-      else
-        req.add_request(r); //enqueue message for processing on a worker thread
-    }
-
-    void Impl::process(const Request& r)
+    void process(Websocket& intf, Workers<Request>& workers, const Request& r)
       try
-        {      
-          Msg<Dummy> header;
-          header.json(r.msgJson);
-          if (header.payloadClass.empty())
-            intf.onMessage(r.client, header);
+        {
+          // latency statistics are handled here, for every server
+          // built on Websocket
+          auto reply=[&](const MsgBase& m) {
+            if (m.msg!=MsgType::stats) return false;
+            Msg<LatencyStats> s(m, workers.latency.stats());
+            s.payload.queued=workers.queue.size();
+            r.client.send(s);
+            return true;
+          };
+          if (r.binary)
+            {
+              auto msg=msgFactory.decode(r.msgJson);
+              if (!reply(*msg))
+                intf.onMessage(r.client, *msg);
+            }
           else
             {
-              cout << header.payloadClass << endl;
-              auto_ptr<MsgBase> msg(msgFactory.create(header.payloadClass));
-              msg->json(r.msgJson);
-              intf.onMessage(r.client, *msg);
+              // unpack just the message header first
+              Msg<NoPayload> header;
+              header.payloadClass.clear();
+              header.json(r.msgJson);
+              if (!reply(header))
+                {
+                  if (header.payloadClass.empty())
+                    intf.onMessage(r.client, header);
+                  else
+                    {
+                      std::unique_ptr<MsgBase> msg(msgFactory.create(header.payloadClass));
+                      msg->json(r.msgJson);
+                      intf.onMessage(r.client, *msg);
+                    }
+                }
             }
+          workers.latency.record(std::chrono::steady_clock::now()-r.received);
         }
       catch (std::exception& ex)
         {
@@ -148,53 +117,82 @@ namespace minsky
           cerr<<"unexpected exception caught"<<endl;
         }
     
+#if 0 // disable websocket
+    class Impl: public server::handler
+    {
+      Websocket& intf; // interface to handle callbacks
+      std::unique_ptr<Workers<Request>> workers;
+      vector<boost::thread> threads;
+      void on_message(connection_ptr con, message_ptr msg); 
+      void threadRoutine();
+    public:
+      Impl(Websocket& intf): intf(intf) {}
+      void start(unsigned workerThreads);
+      void stop();
+      ~Impl() {stop();}
+    };
 
-    void Impl::threadRoutine()
+
+    void Impl::on_message(connection_ptr con,message_ptr msg)
     {
-      while (running)
-        {
-          Request r;
-          req.get_request(r);
-          process(r);
-        }
+      // clients that support binary encoding send binary frames,
+      // and receive replies in kind
+      bool binary=msg->get_opcode()==frame::opcode::BINARY;
+      Request r(new ClientImpl(con, binary), msg->get_payload(), binary);
+      // enqueue message for processing on a worker thread. If the
+      // queue is full, process it here, which applies back pressure
+      // to this connection
+      if (threads.empty() || !workers->push(std::move(r)))
+        process(intf, *workers, r);
     }
 
+    void Impl::threadRoutine()
+    {
+      Request r;
+      while (workers->pop(r))
+        process(intf, *workers, r);
+    }
 
     void Impl::start(unsigned workerThreads)
     {
-      running=true;
+      workers.reset(new Workers<Request>(intf.queueCapacity));
       for (size_t i=0; i<workerThreads; ++i)
-        threads.push_back
-          (classdesc::shared_ptr<thread>
-           (new thread(bind(&Impl::threadRoutine, this))));
+        threads.emplace_back(&Impl::threadRoutine, this);
     }
     
-    Impl::~Impl()
+    void Impl::stop()
     {
-      running=false;
-      // unblock all threads
-      for (size_t i=0; i<threads.size(); ++i)
-        req.add_request(Request());
-      for (size_t i=0; i<threads.size(); ++i)
-        threads[i]->join(); // potential block if a thread has died
+      if (!workers) return;
+      // workers finish the requests they are processing, and exit.
+      // Requests still queued are dropped, so shutdown takes no
+      // longer than the longest request in progress.
+      workers->stop();
+      for (auto& t: threads)
+        t.join();
+      threads.clear();
+      Request r;
+      while (workers->queue.pop(r));
     }
 #else
     class Impl 
     {
     public:
       Impl(Websocket& intf) {}
+      void stop() {}
     };
 #endif
   }
 
   // delegate to impl
   Websocket::Websocket(): impl(new websocket::Impl(*this)),
-                          workerThreads(2), listenerThreads(2), port(80) {}
+                          workerThreads(2), listenerThreads(2), port(80),
+                          queueCapacity(1024) {}
   void Websocket::start() 
   {
 //    impl->start(workerThreads);
 //    server(impl).listen(port, listenerThreads);
   }
+  void Websocket::stop() {impl->stop();}
 
   Websocket::Client::Client(websocket::ClientImpl* c) {}//: impl(c) {}
   void Websocket::Client::send(const MsgBase& msg) const {}//{impl->send(msg);}  
@@ -23,6 +23,7 @@
 #include "message.h"
 
 #include <boost/shared_ptr.hpp>
+#include <algorithm>
 
 namespace minsky
 {
@@ -39,15 +40,31 @@ namespace minsky
     // note boost version required for websocket::server construction
     boost::shared_ptr<websocket::Impl> impl;
   public:
-    /// number of threads handling processing of requests
+    /// number of threads handling processing of requests. Set this
+    /// before opening any resources sized to match, such as
+    /// DatabaseServer's connection pool
     unsigned workerThreads;
     /// number of threads listening on socket connections
     unsigned listenerThreads;
     /// port on which to listen for requests
     unsigned short port;
+    /// number of requests that can wait for a worker thread. Requests
+    /// arriving when the queue is full are processed on the listener
+    /// thread that received them.
+    unsigned queueCapacity;
+    /// maximum number of requests processed concurrently. Listener
+    /// threads process requests themselves when the queue is full, or
+    /// when there are no worker threads, and there is always at least
+    /// one listener.
+    unsigned requestThreads() const
+    {return workerThreads+std::max(1U, listenerThreads);}
     Websocket();
     /// starts the server, using the above parameters
     void start();
+    /// waits for requests in progress to complete, and stops the
+    /// worker threads. Servers must call this in their destructor, as
+    /// onMessage may use their members until it returns.
+    void stop();
 
     class Client
     {
@@ -61,7 +78,9 @@ namespace minsky
     };
 
     /// clients of this class must override this method to provide
-    /// message handling. This method needs to be thread-safe
+    /// message handling. This method needs to be thread-safe. stats
+    /// messages are answered by this class, with the latencies of
+    /// requests handled so far.
     virtual void onMessage(const Client& client, const MsgBase& msg)=0;
 
     virtual ~Websocket() {}
@@ -0,0 +1,235 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+#include "message.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+namespace minsky
+{
+  namespace websocket
+  {
+    /// Bounded multi-producer, multi-consumer queue. Listener threads
+    /// push requests, and worker threads pop them, without taking a
+    /// lock. Each cell carries a sequence number, which tells a
+    /// producer whether the cell is free at its position in the ring,
+    /// and a consumer whether the cell has been filled. After
+    /// D. Vyukov's bounded MPMC queue.
+    template <class T>
+    class MPMCQueue
+    {
+      struct Cell
+      {
+        std::atomic<size_t> sequence;
+        T data;
+      };
+      std::unique_ptr<Cell[]> cells;
+      size_t mask;
+      // on separate cache lines, as producers and consumers update
+      // them from different threads
+      alignas(64) std::atomic<size_t> enqueuePos;
+      alignas(64) std::atomic<size_t> dequeuePos;
+    public:
+      /// \a capacity is rounded up to a power of 2
+      explicit MPMCQueue(size_t capacity)
+      {
+        size_t n=2;
+        while (n<capacity) n*=2;
+        cells.reset(new Cell[n]);
+        mask=n-1;
+        for (size_t i=0; i<n; ++i)
+          cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+      }
+      size_t capacity() const {return mask+1;}
+      /// approximate number of entries, when other threads are active
+      size_t size() const {
+        size_t e=enqueuePos.load(std::memory_order_relaxed),
+          d=dequeuePos.load(std::memory_order_relaxed);
+        return e>d? e-d: 0;
+      }
+
+      /// returns false if the queue is full
+      bool push(T&& x)
+      {
+        Cell* cell;
+        size_t pos=enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+          {
+            cell=&cells[pos&mask];
+            size_t seq=cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif=intptr_t(seq)-intptr_t(pos);
+            if (dif==0)
+              {
+                if (enqueuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                  break;
+              }
+            else if (dif<0)
+              return false;
+            else
+              pos=enqueuePos.load(std::memory_order_relaxed);
+          }
+        cell->data=std::move(x);
+        cell->sequence.store(pos+1, std::memory_order_release);
+        return true;
+      }
+
+      /// returns false if the queue is empty
+      bool pop(T& x)
+      {
+        Cell* cell;
+        size_t pos=dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+          {
+            cell=&cells[pos&mask];
+            size_t seq=cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif=intptr_t(seq)-intptr_t(pos+1);
+            if (dif==0)
+              {
+                if (dequeuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                  break;
+              }
+            else if (dif<0)
+              return false;
+            else
+              pos=dequeuePos.load(std::memory_order_relaxed);
+          }
+        x=std::move(cell->data);
+        cell->data=T(); // release the client connection held by the cell
+        cell->sequence.store(pos+mask+1, std::memory_order_release);
+        return true;
+      }
+    };
+
+    /// Histogram of request latencies, with buckets spaced
+    /// logarithmically, 4 per doubling, from 1µs. Recording is lock
+    /// free, and percentiles are accurate to the bucket width (19%).
+    class LatencyHistogram
+    {
+      static const size_t subBuckets=4, numBuckets=40*subBuckets;
+      std::atomic<uint64_t> counts[numBuckets];
+      std::atomic<uint64_t> maxLatency;
+      static size_t bucket(double us) {
+        return us<1? 0: std::min(numBuckets-1, size_t(subBuckets*std::log2(us))+1);
+      }
+      /// upper bound of bucket \a i, in µs
+      static double upperBound(size_t i) {return i==0? 1: std::exp2(double(i)/subBuckets);}
+    public:
+      LatencyHistogram() {
+        for (auto& i: counts) i.store(0, std::memory_order_relaxed);
+        maxLatency.store(0, std::memory_order_relaxed);
+      }
+      void record(std::chrono::steady_clock::duration latency)
+      {
+        uint64_t us=std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        counts[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t m=maxLatency.load(std::memory_order_relaxed);
+        while (us>m && !maxLatency.compare_exchange_weak(m, us, std::memory_order_relaxed));
+      }
+      LatencyStats stats() const
+      {
+        LatencyStats r;
+        uint64_t c[numBuckets];
+        for (size_t i=0; i<numBuckets; ++i)
+          r.requests+=c[i]=counts[i].load(std::memory_order_relaxed);
+        r.max=maxLatency.load(std::memory_order_relaxed);
+        struct {double fraction; double& value;} percentiles[]=
+          {{0.5,r.p50},{0.9,r.p90},{0.99,r.p99},{0.999,r.p999}};
+        for (auto& p: percentiles)
+          {
+            uint64_t rank=std::ceil(p.fraction*r.requests), cumulative=0;
+            for (size_t i=0; i<numBuckets && cumulative<rank; ++i)
+              if ((cumulative+=c[i])>=rank)
+                p.value=std::min(upperBound(i), r.max);
+          }
+        return r;
+      }
+    };
+
+    /// state shared by the worker threads, processing requests of
+    /// type T. Requests pass through the queue without locking.
+    /// Workers finding it empty spin briefly, then block on a
+    /// condition variable, which a producer only signals when some
+    /// worker is blocked.
+    template <class T>
+    class Workers
+    {
+      std::mutex idleMutex;
+      std::condition_variable wake;
+      std::atomic<unsigned> sleeping{0};
+    public:
+      MPMCQueue<T> queue;
+      std::atomic<bool> running{true};
+      LatencyHistogram latency;
+      Workers(size_t queueCapacity): queue(queueCapacity) {}
+
+      /// enqueue \a r, waking a blocked worker. Returns false if the
+      /// queue is full
+      bool push(T&& r)
+      {
+        if (!queue.push(std::move(r))) return false;
+        // pairs with the fence in pop: either the worker sees this
+        // request, or this sees the worker blocking
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)>0)
+          {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            wake.notify_one();
+          }
+        return true;
+      }
+
+      /// dequeue into \a r, blocking while the queue is empty. Returns
+      /// false once stop() has been called.
+      bool pop(T& r)
+      {
+        // requests tend to arrive in bursts, so spin briefly first
+        for (int i=0; i<64 && running.load(std::memory_order_acquire); ++i)
+          if (queue.pop(r)) return true;
+        std::unique_lock<std::mutex> lock(idleMutex);
+        ++sleeping;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool got=false;
+        while (running.load(std::memory_order_acquire) && !(got=queue.pop(r)))
+          wake.wait(lock);
+        --sleeping;
+        return got;
+      }
+
+      /// wake all workers, so that they exit
+      void stop()
+      {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        running=false;
+        wake.notify_all();
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Load test of the model database. Reports the time taken to upload
+// and download models of increasing numbers of elements, then
+// uploads a model and reports the rate at which its elements can be
+// read back by increasing numbers of concurrent threads.
+// usage: databaseBenchmark connection model.mky [maxThreads]
+// eg databaseBenchmark "postgresql://dbname=minsky" testEq.mky 16
+// The database needs the tables created by server/minskyPG.sql (or
+// minskyMY.sql for MySQL).
+
+#include "server/database.h"
+#include "ecolab_epilogue.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+using namespace minsky;
+using namespace std;
+
+namespace minsky {void doOneEvent() {}}
+
+namespace
+{
+  template <class T> void addIds(vector<int>& ids, const vector<T>& items)
+  {
+    for (auto& i: items)
+      ids.push_back(i.id);
+  }
+
+  /// a model of \a n unwired operations
+  schema1::Minsky syntheticModel(int n)
+  {
+    schema1::Minsky m;
+    m.schemaVersion=schema1::Minsky::version;
+    for (int i=0; i<n; ++i)
+      {
+        m.model.operations.emplace_back();
+        auto& op=m.model.operations.back();
+        op.id=i;
+        op.type=OperationType::time;
+        op.intVar=-1;
+      }
+    return m;
+  }
+
+  double secondsSince(chrono::steady_clock::time_point start)
+  {
+    return chrono::duration<double>(chrono::steady_clock::now()-start).count();
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  if (argc<3)
+    {
+      cerr << "usage: "<<argv[0]<<" connection model.mky [maxThreads]"<<endl;
+      return 1;
+    }
+  unsigned maxThreads=argc>3? atoi(argv[3]): thread::hardware_concurrency();
+  if (maxThreads==0) maxThreads=1;
+
+  try
+    {
+      Database db(argv[1], maxThreads);
+
+      cout << "elements   upload (ms)   download (ms)\n";
+      for (int n: {100, 1000, 10000})
+        {
+          auto m=syntheticModel(n);
+          auto start=chrono::steady_clock::now();
+          int modelId=db.createModel("databaseBenchmark"+to_string(n), "databaseBenchmark", m);
+          double upload=secondsSince(start);
+          schema1::Minsky m1;
+          start=chrono::steady_clock::now();
+          db.readModel(modelId, m1);
+          double download=secondsSince(start);
+          if (m1.model.operations.size()!=size_t(n))
+            cerr << "only "<<m1.model.operations.size()<<" of "<<n<<" elements read back"<<endl;
+          printf("%8d %13.1f %15.1f\n", n, 1000*upload, 1000*download);
+        }
+
+      ifstream inf(argv[2]);
+      xml_unpack_t saveFile(inf);
+      schema1::Minsky minsky;
+      xml_unpack(saveFile, "Minsky", minsky);
+      vector<int> ids;
+      addIds(ids, minsky.model.wires);
+      addIds(ids, minsky.model.operations);
+      addIds(ids, minsky.model.variables);
+      addIds(ids, minsky.model.plots);
+      addIds(ids, minsky.model.groups);
+      addIds(ids, minsky.model.godleys);
+      int modelId=db.createModel(argv[2], "databaseBenchmark", minsky);
+
+      cout << "threads   requests/s\n";
+      for (unsigned n=1; n<=maxThreads; n*=2)
+        {
+          atomic<size_t> requests(0);
+          atomic<bool> running(true);
+          vector<thread> threads;
+          for (unsigned t=0; t<n; ++t)
+            threads.emplace_back([&,t]() {
+                try
+                  {
+                    for (size_t i=t; running; i+=n)
+                      {
+                        db.readElement(modelId, ids[i%ids.size()]);
+                        ++requests;
+                      }
+                  }
+                catch (const std::exception& ex)
+                  {
+                    cerr << ex.what() << endl;
+                    running=false;
+                  }
+              });
+          auto start=chrono::steady_clock::now();
+          this_thread::sleep_for(chrono::seconds(2));
+          running=false;
+          for (auto& t: threads) t.join();
+          printf("%7u %12.0f\n", n, requests/secondsSince(start));
+        }
+    }
+  catch (const std::exception& ex)
+    {
+      cerr << ex.what() << endl;
+      return 1;
+    }
+}
@@ -0,0 +1,110 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Reports the time taken to construct the system of equations of
+// synthetic models of a given number of nodes
+// usage: equationsBenchmark [nodes...]  (default 1000 10000)
+
+#include "minsky.h"
+#include "ecolab_epilogue.h"
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace minsky;
+using namespace std;
+
+namespace minsky {void doOneEvent() {}}
+
+namespace
+{
+  const unsigned chainLength=10;
+
+  /// builds a model of independent chains of chainLength binary
+  /// operations over parameters, each defining a flow variable that
+  /// is integrated. Returns the number of items created
+  size_t buildModel(Minsky& m, size_t nodes)
+  {
+    // each chain consists of 2*chainLength operations and parameters,
+    // a flow variable and an integral
+    for (size_t chain=0; chain<nodes/(2*chainLength+2); ++chain)
+      {
+        auto prefix="c"+to_string(chain)+"_";
+        ItemPtr prev=m.model->addItem(VariablePtr(VariableType::parameter,prefix+"p0"));
+        for (unsigned i=1; i<chainLength; ++i)
+          {
+            auto p=m.model->addItem(VariablePtr(VariableType::parameter,prefix+"p"+to_string(i)));
+            auto op=m.model->addItem(OperationPtr(i%2? OperationType::add: OperationType::multiply));
+            m.model->addWire(*prev,*op,1);
+            m.model->addWire(*p,*op,2);
+            prev=op;
+          }
+        auto f=m.model->addItem(VariablePtr(VariableType::flow,prefix+"f"));
+        m.model->addWire(*prev,*f,1);
+        auto integ=m.model->addItem(OperationPtr(OperationType::integrate));
+        m.model->addWire(*f,*integ,1);
+      }
+    return m.model->numItems();
+  }
+
+  /// returns average time in seconds of calling \a f
+  template <class F> double timeOf(F f)
+  {
+    using namespace std::chrono;
+    auto start=steady_clock::now();
+    size_t n=0;
+    duration<double> elapsed;
+    do
+      {
+        f();
+        ++n;
+        elapsed=steady_clock::now()-start;
+      }
+    while (elapsed.count()<1);
+    return elapsed.count()/n;
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  vector<size_t> sizes;
+  for (int i=1; i<argc; ++i)
+    sizes.push_back(atol(argv[i]));
+  if (sizes.empty())
+    sizes={1000, 10000};
+
+  cout << "    nodes   SystemOfEquations (ms)   constructEquations (ms)\n";
+  for (auto nodes: sizes)
+    {
+      Minsky m;
+      LocalMinsky lm(m);
+      try
+        {
+          auto items=buildModel(m, nodes);
+          m.constructEquations();
+          double dag=timeOf([&]() {MathDAG::SystemOfEquations system(m);});
+          double construct=timeOf([&]() {m.constructEquations();});
+          printf("%9zu %24.2f %25.2f\n", items, 1000*dag, 1000*construct);
+        }
+      catch (const std::exception& ex)
+        {
+          cerr << nodes << ": " << ex.what() << endl;
+        }
+    }
+}
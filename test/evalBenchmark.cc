@@ -0,0 +1,84 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Reports flow equation evaluations per second of the EvalOpVector
+// (virtual dispatch) and compiled EvalProgram representations
+// usage: evalBenchmark x.mky...  (eg examples/*.mky)
+
+#include "minsky.h"
+#include "ecolab_epilogue.h"
+#include <chrono>
+#include <stdio.h>
+#include <iostream>
+using namespace minsky;
+using namespace std;
+
+namespace minsky {void doOneEvent() {}}
+
+namespace
+{
+  /// returns number of calls of \a f per second, run for roughly a second
+  template <class F> double rate(F f)
+  {
+    using namespace std::chrono;
+    auto start=steady_clock::now();
+    size_t n=0;
+    duration<double> elapsed;
+    do
+      {
+        for (int i=0; i<100; ++i) f();
+        n+=100;
+        elapsed=steady_clock::now()-start;
+      }
+    while (elapsed.count()<1);
+    return n/elapsed.count();
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  cout << "model                                     ops   instructions   EvalOpVector/s   EvalProgram/s   speedup\n";
+  for (int arg=1; arg<argc; ++arg)
+    {
+      Minsky m;
+      LocalMinsky lm(m);
+      try
+        {
+          m.load(argv[arg]);
+          m.constructEquations();
+          if (m.flowVars.empty()) continue;
+          if (m.stockVars.empty()) m.stockVars.resize(1,0);
+
+          vector<double> flow(m.flowVars);
+          double before=rate([&]() {
+              for (auto& e: m.equations)
+                e->eval(&flow[0], &m.stockVars[0]);
+            });
+          double after=rate([&]() {
+              m.compiledEquations.eval(&flow[0], &m.stockVars[0]);
+            });
+          printf("%-40s %5zu %14zu %16.0f %15.0f %9.2f\n", argv[arg], m.equations.size(),
+                 m.compiledEquations.size(), before, after, after/before);
+        }
+      catch (const std::exception& ex)
+        {
+          cerr << argv[arg] << ": " << ex.what() << endl;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Reports the time taken for hit testing and mouse hover over
+// synthetic models of a given number of items
+// usage: hoverBenchmark [items...]  (default 1000 10000)
+
+#include "minsky.h"
+#include "ecolab_epilogue.h"
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace minsky;
+using namespace std;
+
+namespace minsky {void doOneEvent() {}}
+
+namespace
+{
+  /// lays out \a n variables on a square grid, wiring each to its
+  /// neighbour
+  void buildModel(Minsky& m, size_t n)
+  {
+    size_t side=ceil(sqrt(n));
+    ItemPtr prev;
+    for (size_t i=0; i<n; ++i)
+      {
+        auto v=m.model->addItem(VariablePtr(VariableType::flow,"v"+to_string(i)));
+        v->moveTo(100*(i%side), 50*(i/side));
+        if (prev && i%side)
+          m.model->addWire(*prev,*v,1);
+        prev=v;
+      }
+  }
+
+  /// returns average time in seconds of calling \a f
+  template <class F> double timeOf(F f)
+  {
+    using namespace std::chrono;
+    auto start=steady_clock::now();
+    size_t n=0;
+    duration<double> elapsed;
+    do
+      {
+        f();
+        ++n;
+        elapsed=steady_clock::now()-start;
+      }
+    while (elapsed.count()<1);
+    return elapsed.count()/n;
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  vector<size_t> sizes;
+  for (int i=1; i<argc; ++i)
+    sizes.push_back(atol(argv[i]));
+  if (sizes.empty())
+    sizes={1000, 10000};
+
+  cout << "    items   linear itemAt (us)   itemAt (us)   getWireAt (us)   mouseMove (us)   move+itemAt (us)\n";
+  for (auto n: sizes)
+    {
+      Minsky m;
+      LocalMinsky lm(m);
+      try
+        {
+          buildModel(m, n);
+          float w=100*ceil(sqrt(n)), h=50*ceil(n/ceil(sqrt(n)));
+          default_random_engine gen;
+          uniform_real_distribution<float> xs(0,w), ys(0,h);
+          double linear=timeOf([&]() {
+              float x=xs(gen), y=ys(gen);
+              m.model->findAny(&Group::items, [&](const ItemPtr& i)
+                               {return i->visible() && i->contains(x,y);});
+            });
+          double itemAt=timeOf([&]() {m.canvas.itemAt(xs(gen),ys(gen));});
+          double wireAt=timeOf([&]() {m.canvas.getWireAt(xs(gen),ys(gen));});
+          double move=timeOf([&]() {m.canvas.mouseMove(xs(gen),ys(gen));});
+          // dragging an item, which updates only its own grid cells
+          auto& items=m.model->items;
+          double drag=timeOf([&]() {
+              items[gen()%items.size()]->moveTo(xs(gen),ys(gen));
+              m.canvas.itemAt(xs(gen),ys(gen));
+            });
+          printf("%9zu %20.2f %13.2f %16.2f %16.2f %18.2f\n", n, 1e6*linear, 1e6*itemAt, 1e6*wireAt, 1e6*move, 1e6*drag);
+        }
+      catch (const std::exception& ex)
+        {
+          cerr << n << ": " << ex.what() << endl;
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares the JSON and binary encodings of the messages creating and
+// reading a model, reporting messages encoded and decoded per second,
+// and bytes per message. As well as any models given, a synthetic
+// model of data operations holding 1000 points each is measured.
+// usage: messageBenchmark [x.mky...]  (eg examples/*.mky)
+
+#include "server/message.h"
+#include "schema1.h"
+#include "ecolab_epilogue.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdio.h>
+using namespace minsky;
+using namespace std;
+
+namespace minsky {void doOneEvent() {}}
+
+namespace
+{
+  /// returns the rate per second at which \a f can be called
+  template <class F> double rateOf(F f)
+  {
+    using namespace std::chrono;
+    auto start=steady_clock::now();
+    size_t n=0;
+    duration<double> elapsed;
+    do
+      {
+        f();
+        ++n;
+        elapsed=steady_clock::now()-start;
+      }
+    while (elapsed.count()<0.5);
+    return n/elapsed.count();
+  }
+
+  schema1::Minsky syntheticModel()
+  {
+    schema1::Minsky m;
+    m.schemaVersion=schema1::Minsky::version;
+    for (int i=0; i<100; ++i)
+      {
+        m.model.operations.emplace_back();
+        auto& op=m.model.operations.back();
+        op.id=i;
+        op.type=OperationType::data;
+        op.intVar=-1;
+        for (int j=0; j<1000; ++j)
+          op.data[0.01*j]=sin(0.01*i*j);
+      }
+    return m;
+  }
+
+  void measure(const string& name, const schema1::Minsky& model)
+  {
+    for (auto type: {MsgType::create, MsgType::read})
+      {
+        Msg<schema1::Minsky> m;
+        m.msg=type;
+        m.modelId=1;
+        m.payload=model;
+        const char* typeName=type==MsgType::create? "create": "read";
+
+        string json=m.json();
+        double jsonEncode=rateOf([&]() {m.json();});
+        double jsonDecode=rateOf([&]() {
+            unique_ptr<MsgBase> r(msgFactory.create("Minsky"));
+            r->json(json);
+          });
+        printf("%-37s %-6s %-6s %12.1f %12.1f %12zu\n", name.c_str(), typeName,
+               "JSON", jsonEncode, jsonDecode, json.size());
+
+        string binary=m.binary();
+        double binaryEncode=rateOf([&]() {m.binary();});
+        double binaryDecode=rateOf([&]() {msgFactory.decode(binary);});
+        printf("%-37s %-6s %-6s %12.1f %12.1f %12zu\n", name.c_str(), typeName,
+               "binary", binaryEncode, binaryDecode, binary.size());
+      }
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  cout << "model                                 msg    format  encodes/s    decodes/s  bytes/msg\n";
+  measure("synthetic", syntheticModel());
+  for (int arg=1; arg<argc; ++arg)
+    try
+      {
+        ifstream inf(argv[arg]);
+        xml_unpack_t saveFile(inf);
+        schema1::Minsky m;
+        xml_unpack(saveFile, "Minsky", m);
+        measure(argv[arg], m);
+      }
+    catch (const std::exception& ex)
+      {
+        cerr << argv[arg] << ": " << ex.what() << endl;
+      }
+}
@@ -0,0 +1,110 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares the time taken to save and load models, and the file
+// sizes, of the XML and binary formats
+// usage: saveBenchmark x.mky...  (eg examples/*.mky)
+
+#include "minsky.h"
+#include "ecolab_epilogue.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdio.h>
+#include <sys/stat.h>
+using namespace minsky;
+using namespace std;
+
+namespace minsky {void doOneEvent() {}}
+
+namespace
+{
+  /// returns average time in seconds of calling \a f
+  template <class F> double timeOf(F f)
+  {
+    using namespace std::chrono;
+    auto start=steady_clock::now();
+    size_t n=0;
+    duration<double> elapsed;
+    do
+      {
+        f();
+        ++n;
+        elapsed=steady_clock::now()-start;
+      }
+    while (elapsed.count()<0.5);
+    return elapsed.count()/n;
+  }
+
+  size_t fileSize(const string& filename)
+  {
+    struct stat s;
+    return stat(filename.c_str(), &s)==0? s.st_size: 0;
+  }
+
+  struct Result
+  {
+    double save, load;
+    size_t size;
+  };
+
+  template <class S> Result measure(Minsky& m, const string& filename, S save)
+  {
+    Result r;
+    r.save=timeOf([&]() {save(filename);});
+    r.size=fileSize(filename);
+    r.load=timeOf([&]() {m.load(filename);});
+    remove(filename.c_str());
+    return r;
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  cout << "model                                 format     save (ms)   load (ms)   size (bytes)\n";
+  for (int arg=1; arg<argc; ++arg)
+    {
+      Minsky m;
+      LocalMinsky lm(m);
+      try
+        {
+          m.load(argv[arg]);
+          struct Format
+          {
+            const char* name;
+            const char* extension;
+            function<void(const string&)> save;
+          } formats[]={
+            {"XML", ".mky", [&](const string& f) {m.save(f);}},
+            {"binary", ".mkyb", [&](const string& f) {m.saveBinary(f,false);}},
+            {"zbinary", ".mkyz", [&](const string& f) {m.saveBinary(f,true);}}
+          };
+          for (auto& f: formats)
+            {
+              auto r=measure(m, string("saveBenchmark")+f.extension, f.save);
+              printf("%-37s %-8s %11.2f %11.2f %14zu\n", argv[arg], f.name,
+                     1000*r.save, 1000*r.load, r.size);
+            }
+        }
+      catch (const std::exception& ex)
+        {
+          cerr << argv[arg] << ": " << ex.what() << endl;
+        }
+    }
+}
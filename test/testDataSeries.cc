@@ -0,0 +1,134 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dataSeries.h"
+#include <ecolab_epilogue.h>
+#include <UnitTest++/UnitTest++.h>
+#include <fstream>
+#include <stdio.h>
+using namespace minsky;
+using namespace std;
+
+SUITE(DataSeries)
+{
+  TEST(readText)
+    {
+      {
+        ofstream f("testDataSeries.csv");
+        f << "time,value\n"
+          << "# comment\n"
+          << "2,20\r\n"
+          << "1 ; 10\n"
+          << "3\t30\n"
+          << "2, 25\n"
+          << "4\n";
+      }
+      DataSeries d;
+      d.readText("testDataSeries.csv");
+      remove("testDataSeries.csv");
+      // sorted, with the last of repeated x values retained
+      CHECK_EQUAL(3, d.size());
+      map<double,double> expected{{1,10},{2,25},{3,30}};
+      CHECK(expected==d.toMap());
+    }
+
+  TEST(readTextPairsAcrossLines)
+    {
+      {
+        ofstream f("testDataSeries.txt");
+        f << "1 10 2 20\n"
+          << "3\n"
+          << "30 # comment\n"
+          << "x y\n"
+          << "4,40;5 50\n";
+      }
+      DataSeries d;
+      d.readText("testDataSeries.txt");
+      remove("testDataSeries.txt");
+      map<double,double> expected{{1,10},{2,20},{3,30},{4,40},{5,50}};
+      CHECK(expected==d.toMap());
+    }
+
+  TEST(interpolate)
+    {
+      map<double,double> data;
+      for (int i=0; i<100; ++i)
+        data[i*i]=i%7;
+      DataSeries d(data);
+      DataSeries::Cursor cursor;
+      // forwards in small steps, as simulation time does, then at random
+      vector<double> xs;
+      for (double x=-10; x<10000; x+=3.5) xs.push_back(x);
+      for (int i=0; i<1000; ++i) xs.push_back((rand()%11000)-500);
+      for (double x: xs)
+        {
+          // compare with interpolation via the map
+          auto v=data.lower_bound(x);
+          double y;
+          if (v==data.end())
+            y=data.rbegin()->second;
+          else if (v==data.begin() || v->first==x)
+            y=v->second;
+          else
+            {
+              auto v0=v; --v0;
+              y=(x-v0->first)*(v->second-v0->second)/(v->first-v0->first)+v0->second;
+            }
+          CHECK_CLOSE(y, d.interpolate(x, cursor), 1e-10);
+        }
+      CHECK_EQUAL(0, d.deriv(-1, cursor));
+      CHECK_CLOSE(1.0/3, d.deriv(2, cursor), 1e-10);
+      // at a data point, the derivative spans the neighbouring intervals
+      CHECK_CLOSE(2.0/8, d.deriv(4, cursor), 1e-10);
+    }
+
+  TEST(uniform)
+    {
+      map<double,double> data;
+      for (int i=0; i<1000; ++i)
+        data[0.1*i-3]=i%13;
+      DataSeries d(data), nonUniform(map<double,double>{{0,0},{1,1},{3,2}});
+      CHECK(d.uniform());
+      CHECK(!nonUniform.uniform());
+      // random lookups, which the cursor can't help with
+      DataSeries::Cursor cursor;
+      for (int i=0; i<1000; ++i)
+        {
+          double x=0.001*(rand()%99000)-3;
+          CHECK_EQUAL(data.lower_bound(x)->first, d.x()[d.lowerBound(x, cursor)]);
+        }
+      // including at the data points themselves
+      for (auto& i: data)
+        CHECK_EQUAL(i.second, d.interpolate(i.first, cursor));
+    }
+
+  TEST(binary)
+    {
+      DataSeries d, d1;
+      d.assign({3,1,2}, {30,10,20});
+      d.writeBinary("testDataSeries.dat");
+      CHECK(DataSeries::isBinaryFile("testDataSeries.dat"));
+      d1.readBinary("testDataSeries.dat");
+      remove("testDataSeries.dat");
+      CHECK(d.x()==d1.x());
+      CHECK(d.y()==d1.y());
+      CHECK_EQUAL(1, d1.x()[0]);
+      CHECK_EQUAL(30, d1.y()[2]);
+    }
+}
@@ -20,7 +20,9 @@
 #include "server/database.h"
 #include <ecolab_epilogue.h>
 #include <UnitTest++/UnitTest++.h>
+#include <boost/filesystem.hpp>
 #include <fstream>
+#include <set>
 #include <string>
 #include <stdlib.h>
 
@@ -43,7 +45,8 @@ namespace
             CHECK_EQUAL(i->json(), itemT->json());
 
             // now create a copy of an element, then read it back to check
-            int newId=db.createElement(modelId, *itemT);
+            db.createElement(modelId, *itemT);
+            int newId=itemT->id;
             item=db.readElement(modelId, newId);
             CHECK_EQUAL(newId, item->id);
             CHECK(newId != i->id); // should be a distinct id
@@ -62,6 +65,91 @@ namespace
 
 SUITE(Database)
 {
+  /// a fresh SQLite database in a temporary file, with the tables of
+  /// server/minskyPG.sql, so the round trip tests below do not need a
+  /// database server
+  struct SQLiteDatabase
+  {
+    boost::filesystem::path file;
+    string dbConnection;
+    SQLiteDatabase():
+      file(boost::filesystem::temp_directory_path()/
+           boost::filesystem::unique_path("minsky-%%%%-%%%%.sqlite")),
+      dbConnection("sqlite3://db="+file.string())
+    {
+      soci::session db(dbConnection);
+      db << "create table models (id integer primary key, name varchar(255), "
+        "owner varchar(255), maxelem integer, data text, "
+        "revision integer default 0 not null)";
+      db << "create table elements (modelid integer not null, id integer not null, "
+        "type varchar, data text, revision integer default 0 not null, "
+        "primary key (modelid, id))";
+      db << "create table layouts (modelid integer not null, id integer not null, "
+        "type varchar, data text, revision integer default 0 not null)";
+      db << "create table deletedelements (modelid integer not null, "
+        "id integer not null, revision integer not null)";
+    }
+    ~SQLiteDatabase() {boost::filesystem::remove(file);}
+  };
+
+  TEST_FIXTURE(SQLiteDatabase, modelRoundTrip)
+  {
+    // more elements than are fetched in one chunk, so the bulk reads
+    // need more than one round trip
+    const int numOps=1500;
+    schema1::Minsky minsky;
+    minsky.schemaVersion=schema1::Minsky::version;
+    for (int i=0; i<numOps; ++i)
+      {
+        minsky.model.operations.emplace_back();
+        auto& op=minsky.model.operations.back();
+        op.id=i;
+        op.type=OperationType::time;
+        op.intVar=-1;
+        // every other element has an explicit layout, the rest get a default
+        if (i%2==0)
+          minsky.layout.emplace_back(new schema1::PositionLayout(i, 10*i, 20*i));
+      }
+
+    Database db(dbConnection);
+    int model=db.createModel("roundTrip", "testUser", minsky);
+    schema1::Minsky m1;
+    int rev=db.readModel(model, m1);
+    CHECK_EQUAL(rev, db.revision(model));
+
+    CHECK_EQUAL(numOps, m1.model.operations.size());
+    set<int> opIds;
+    for (auto& op: m1.model.operations)
+      opIds.insert(op.id);
+    CHECK_EQUAL(numOps, opIds.size());
+
+    // one layout per element
+    CHECK_EQUAL(numOps, m1.layout.size());
+    set<int> layoutIds;
+    for (auto& l: m1.layout)
+      {
+        layoutIds.insert(l->id);
+        if (l->id%2==0)
+          {
+            auto p=dynamic_cast<schema1::PositionLayout*>(l.get());
+            CHECK(p);
+            if (p)
+              {
+                CHECK_EQUAL(10*l->id, p->x);
+                CHECK_EQUAL(20*l->id, p->y);
+              }
+          }
+      }
+    CHECK(layoutIds==opIds);
+
+    // the id of a new model is that allocated by its insert
+    int model2=db.createModel("roundTrip2", "testUser", minsky);
+    CHECK(model2!=model);
+    schema1::Minsky m2;
+    db.readModel(model2, m2);
+    CHECK_EQUAL(numOps, m2.model.operations.size());
+  }
+
   /*
     to use this test, create a file with two lines in it, containing a .mky file, and a database connection string:
 
@@ -76,18 +164,25 @@ SUITE(Database)
      Then set the MINSKY_TEST_DATABASE_PARAMS environment variable to point to this file
   */
 
-  TEST(loadDatabase)
+  struct DatabaseParams
   {
-    // read in some parameters for this text
-    char* paramFile=getenv("MINSKY_TEST_DATABASE_PARAMS");
-    if (!paramFile) 
-      throw runtime_error
-        ("MINSKY_TEST_DATABASE_PARAMS environment variable not set");
-
-    ifstream paramF(paramFile);
     string modelFile, dbConnection;
-    getline(paramF, modelFile);
-    getline(paramF, dbConnection);
+    DatabaseParams()
+    {
+      // read in some parameters for this text
+      char* paramFile=getenv("MINSKY_TEST_DATABASE_PARAMS");
+      if (!paramFile) 
+        throw runtime_error
+          ("MINSKY_TEST_DATABASE_PARAMS environment variable not set");
+
+      ifstream paramF(paramFile);
+      getline(paramF, modelFile);
+      getline(paramF, dbConnection);
+    }
+  };
+
+  TEST_FIXTURE(DatabaseParams, loadDatabase)
+  {
 
 //    cout << modelFile << endl;
 //    cout << dbConnection << endl;
@@ -113,4 +208,54 @@ SUITE(Database)
     checkVectorElements(db, model, minsky.model.godleys);
     
   }
+
+  TEST_FIXTURE(DatabaseParams, changeFeed)
+  {
+    Database db(dbConnection);
+    ifstream inf(modelFile.c_str());
+    xml_unpack_t saveFile(inf);
+    schema1::Minsky minsky;
+    xml_unpack(saveFile, "Minsky", minsky);
+    CHECK(!minsky.model.operations.empty());
+
+    int model=db.createModel(modelFile, "testUser", minsky);
+    schema1::Minsky m1;
+    int rev=db.readModel(model, m1);
+    CHECK_EQUAL(rev, db.revision(model));
+    ModelChanges changes;
+    CHECK_EQUAL(rev, db.changesSince(model, rev, changes));
+    CHECK(changes.elements.empty() && changes.layouts.empty() && changes.deleted.empty());
+
+    // create, update and delete an element
+    schema1::Operation op=minsky.model.operations.front();
+    int createRev=db.createElement(model, op);
+    CHECK(createRev>rev);
+    int newId=op.id;
+    // a default layout is created with the element
+    CHECK_EQUAL(newId, db.readLayout(model, newId)->id);
+    op.value=42;
+    int updateRev=db.updateElement(model, op);
+    CHECK(updateRev>createRev);
+    schema1::Operation& deleted=minsky.model.operations.back();
+    int deleteRev=db.deleteElement(model, deleted);
+    CHECK(deleteRev>updateRev);
+
+    CHECK_EQUAL(deleteRev, db.changesSince(model, rev, changes));
+    CHECK_EQUAL(1, changes.elements.size());
+    CHECK_EQUAL(1, changes.layouts.size());
+    if (!changes.elements.empty())
+      {
+        CHECK_EQUAL(newId, changes.elements[0].id);
+        CHECK_EQUAL(op.json(), changes.elements[0].data);
+      }
+    CHECK_EQUAL(1, changes.deleted.size());
+    if (!changes.deleted.empty())
+      CHECK_EQUAL(deleted.id, changes.deleted[0]);
+
+    // only the deletion follows the update
+    ModelChanges sinceUpdate;
+    db.changesSince(model, updateRev, sinceUpdate);
+    CHECK(sinceUpdate.elements.empty());
+    CHECK_EQUAL(1, sinceUpdate.deleted.size());
+  }
 }
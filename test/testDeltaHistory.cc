@@ -0,0 +1,89 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "deltaHistory.h"
+#include <UnitTest++/UnitTest++.h>
+#include <string>
+using namespace minsky;
+using namespace std;
+
+namespace
+{
+  bool push(DeltaHistory& h, const string& s) {return h.push(s.data(), s.size());}
+  string get(const DeltaHistory& h, size_t i)
+  {
+    vector<char> state;
+    h.get(i, state);
+    return string(state.begin(), state.end());
+  }
+}
+
+SUITE(DeltaHistory)
+{
+  TEST(identicalStatesNotPushed)
+    {
+      DeltaHistory h;
+      CHECK(push(h, "hello world"));
+      CHECK(!push(h, "hello world"));
+      CHECK(push(h, "hello"));
+      CHECK_EQUAL(2, h.size());
+    }
+
+  TEST(statesReconstructed)
+    {
+      DeltaHistory h;
+      vector<string> states;
+      string s(1000,'a');
+      for (size_t i=0; i<3*DeltaHistory::keyframeInterval; ++i)
+        {
+          // a mixture of replacements, insertions and deletions
+          switch (i%3)
+            {
+            case 0: s[(37*i)%s.size()]='b'+i%20; break;
+            case 1: s.insert((53*i)%s.size(), "xyz"); break;
+            case 2: s.erase((71*i)%s.size(), 2); break;
+            }
+          states.push_back(s);
+          CHECK(push(h, s));
+        }
+      for (size_t i=0; i<states.size(); ++i)
+        CHECK_EQUAL(states[i], get(h,i));
+
+      // deltas are much smaller than the states
+      CHECK(h.memoryUsage() < 10*states.size()*sizeof(size_t)+5*s.size());
+    }
+
+  TEST(truncate)
+    {
+      DeltaHistory h;
+      vector<string> states;
+      for (size_t i=0; i<2*DeltaHistory::keyframeInterval+3; ++i)
+        {
+          states.push_back("state "+to_string(i)+" of the model");
+          push(h, states.back());
+        }
+      h.truncate(5);
+      CHECK_EQUAL(5, h.size());
+      for (size_t i=0; i<5; ++i)
+        CHECK_EQUAL(states[states.size()-5+i], get(h,i));
+      push(h, "another");
+      CHECK_EQUAL("another", get(h,5));
+      CHECK_EQUAL(states.back(), get(h,4));
+    }
+}
@@ -0,0 +1,93 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/message.h"
+#include "schema1.h"
+#include <ecolab_epilogue.h>
+#include <UnitTest++/UnitTest++.h>
+
+using namespace minsky;
+using namespace std;
+
+SUITE(Message)
+{
+  TEST(binaryModel)
+    {
+      Msg<schema1::Minsky> m;
+      m.msg=MsgType::create;
+      m.modelId=3;
+      m.revision=7;
+      m.payload.schemaVersion=schema1::Minsky::version;
+      for (int i=0; i<10; ++i)
+        {
+          schema1::Operation op;
+          op.id=i;
+          op.type=OperationType::data;
+          op.intVar=-1;
+          for (int j=0; j<100; ++j)
+            op.data[0.1*j]=i*j;
+          m.payload.model.operations.push_back(op);
+          m.payload.layout.emplace_back(new schema1::PositionLayout);
+          m.payload.layout.back()->id=i;
+        }
+
+      string frame=m.binary();
+      unique_ptr<MsgBase> r=msgFactory.decode(frame);
+      auto m1=dynamic_cast<Msg<schema1::Minsky>*>(r.get());
+      CHECK(m1);
+      if (m1)
+        {
+          CHECK_EQUAL(MsgType::create, m1->msg);
+          CHECK_EQUAL(3, m1->modelId);
+          CHECK_EQUAL(7, m1->revision);
+          CHECK_EQUAL(m.json(), m1->json());
+        }
+
+      // corrupt frames are rejected
+      CHECK_THROW(msgFactory.decode(frame.substr(0,frame.size()-1)), std::exception);
+    }
+
+  TEST(binaryElement)
+    {
+      MsgPPtr<schema1::Item> m;
+      m.msg=MsgType::update;
+      schema1::Variable* v=new schema1::Variable;
+      v->id=5;
+      v->name="foo";
+      m.setPayload(v);
+
+      unique_ptr<MsgBase> r=msgFactory.decode(m.binary());
+      CHECK_EQUAL(MsgType::update, r->msg);
+      auto v1=dynamic_cast<const schema1::Variable*>(r->payloadAsPolyBase());
+      CHECK(v1);
+      if (v1)
+        CHECK_EQUAL(v->json(), v1->json());
+    }
+
+  TEST(binaryHeader)
+    {
+      Msg<NoPayload> m;
+      m.msg=MsgType::changes;
+      m.payloadClass="";
+      m.revision=2;
+      unique_ptr<MsgBase> r=msgFactory.decode(m.binary());
+      CHECK_EQUAL(MsgType::changes, r->msg);
+      CHECK_EQUAL(2, r->revision);
+    }
+}
@@ -16,12 +16,37 @@
   You should have received a copy of the GNU General Public License
   along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include "evalKernels.h"
 #include "minsky.h"
+#include "parameterSweep.h"
+#include "schema2.h"
 #include <ecolab_epilogue.h>
 #include <UnitTest++/UnitTest++.h>
 #include <gsl/gsl_integration.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdlib.h>
 using namespace minsky;
 
+namespace
+{
+  /// count of calls to global operator new, for checking code paths
+  /// are allocation free
+  std::atomic<size_t> numAllocations{0};
+}
+
+void* operator new(size_t sz)
+{
+  ++numAllocations;
+  if (void* p=malloc(sz? sz: 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {free(p);}
+
 namespace
 {
   struct TestFixture: public Minsky
@@ -210,6 +235,7 @@ SUITE(Minsky)
       CHECK_EQUAL(20,variableValues[":d"].value());
       CHECK_EQUAL(30,variableValues[":e"].value());
       CHECK_EQUAL(5,variableValues[":a"].value());
+      CHECK_EQUAL(2,evalGodley.nonZeros());
       for (size_t i=0; i<stockVars.size(); ++i)
         stockVars[i]=0;
      
@@ -282,6 +308,9 @@ SUITE(Minsky)
  
       save("derivative.mky");
       jacobian(jac,t,&stockVars[0]);
+      // columns {c,d} and {e,x} share nonzero rows, so only two sweeps
+      // are needed
+      CHECK_EQUAL(2, jacobianSparsity.colours.size());
    
       CHECK_EQUAL(0, jac(0,0));
       CHECK_EQUAL(0, jac(0,1));  
@@ -301,6 +330,50 @@ SUITE(Minsky)
       CHECK_EQUAL(0,jac(3,3));
     }
 
+  // check that evaluating the RHS and Jacobian does not allocate
+  TEST_FIXTURE(TestFixture,evalEquationsAllocationFree)
+    {
+      auto gi=new GodleyIcon;
+      model->addItem(gi);
+      GodleyTable& godley=gi->table;
+      godley.resize(3,4);
+      godley.cell(0,1)="c";
+      godley.cell(0,2)="d";
+      godley.cell(0,3)="e";
+      godley.cell(2,1)="a";
+      godley.cell(2,2)="b";
+      godley.cell(2,3)="f";
+      gi->update();
+
+      map<string, VariablePtr> var;
+      for (ItemPtr& i: model->items)
+        if (auto v=dynamic_pointer_cast<VariableBase>(i))
+          var[v->name()]=v;
+
+      auto op1=model->addItem(OperationPtr(OperationType::add));
+      auto op2=model->addItem(OperationPtr(OperationType::integrate));
+      auto op3=model->addItem(OperationPtr(OperationType::multiply));
+      model->addWire(*var["e"], *var["f"], 1);
+      model->addWire(*var["c"], *op1, 1);
+      model->addWire(*var["d"], *op1, 2);
+      model->addWire(*op1, *op2, 1);
+      model->addWire(*op2, *var["a"], 1);
+      model->addWire(*op2, *op3, 1);
+      model->addWire(*var["e"],* op3, 2);
+      model->addWire(*op3, *var["b"], 1);
+      reset();
+
+      vector<double> result(stockVars.size()), j(stockVars.size()*stockVars.size());
+      Matrix jac(stockVars.size(),&j[0]);
+      size_t allocs=numAllocations;
+      for (int i=0; i<10; ++i)
+        {
+          evalEquations(&result[0], t, &stockVars[0]);
+          jacobian(jac, t, &stockVars[0]);
+        }
+      CHECK_EQUAL(allocs, size_t(numAllocations));
+    }
+
   TEST_FIXTURE(TestFixture,integrals)
     {
       // First, integrate a constant
@@ -334,6 +407,172 @@ SUITE(Minsky)
       CHECK_CLOSE(0.5*value*t*t, intOp->intVar->value(), 1e-5);
     }
 
+  TEST_FIXTURE(TestFixture,updateEquations)
+    {
+      auto k=model->addItem(VariablePtr(VariableType::parameter,"k"));
+      auto& kv=dynamic_cast<VariableBase&>(*k);
+      kv.init("2");
+      auto intOp=model->addItem(OperationPtr(OperationBase::integrate));
+      dynamic_cast<IntOp&>(*intOp).description("x");
+      model->addWire(*k,*intOp,1,vector<float>());
+      nSteps=1;
+      reset();
+      step();
+      auto x=[&]() {return variableValues[":x"].value();};
+      CHECK_CLOSE(2*t, x(), 1e-5);
+
+      // layout changes do not cause the equations to be rebuilt,
+      // nor the simulation to restart
+      auto op=equations[0].get();
+      double t1=t;
+      k->moveTo(100,100);
+      markEdited();
+      step();
+      CHECK(op==equations[0].get());
+      CHECK(t>t1);
+      CHECK_CLOSE(2*t, x(), 1e-5);
+
+      // parameter changes are picked up without rebuilding
+      double t2=t, x2=x();
+      kv.init("3");
+      markEdited();
+      step();
+      CHECK(op==equations[0].get());
+      CHECK_CLOSE(x2+3*(t-t2), x(), 1e-5);
+
+      // structural changes rebuild, but preserve stock values
+      double t3=t, x3=x();
+      auto intOp2=model->addItem(OperationPtr(OperationBase::integrate));
+      model->addWire(*intOp,*intOp2,1,vector<float>());
+      markEdited();
+      step();
+      CHECK(t>t3);
+      CHECK_CLOSE(x3+3*(t-t3), x(), 1e-5);
+
+      // an explicit reset restarts the simulation
+      reset();
+      CHECK_EQUAL(t0, t);
+      CHECK_EQUAL(0, x());
+    }
+
+  TEST_FIXTURE(TestFixture,structuralSignature)
+    {
+      auto a=model->addItem(VariablePtr(VariableType::flow,"a"));
+      auto p=model->addItem(VariablePtr(VariableType::parameter,"p"));
+      auto op=model->addItem(OperationPtr(OperationType::exp));
+      auto w=model->addWire(*p,*op,1,vector<float>());
+      model->addWire(*op,*a,1,vector<float>());
+      auto sig=structuralSignature();
+
+      // layout, wire routing and parameter values are not structural
+      a->moveTo(100,100);
+      w->coords(vector<float>{0,0,50,50,100,0});
+      dynamic_cast<VariableBase&>(*p).init("5");
+      CHECK_EQUAL(sig, structuralSignature());
+
+      // names and connections are
+      dynamic_cast<VariableBase&>(*a).name("b");
+      auto sig2=structuralSignature();
+      CHECK(sig2!=sig);
+      model->removeWire(*w);
+      auto sig3=structuralSignature();
+      CHECK(sig3!=sig2);
+
+      // as are units
+      dynamic_cast<VariableBase&>(*a).units("m");
+      auto sig4=structuralSignature();
+      CHECK(sig4!=sig3);
+
+      // replacing an item by an identical copy changes the signature,
+      // as the equations refer to the original
+      auto removed=model->removeItem(*op);
+      model->addItem(removed->clone());
+      CHECK(structuralSignature()!=sig4);
+    }
+
+  TEST_FIXTURE(TestFixture,logVariables)
+    {
+      auto k=model->addItem(VariablePtr(VariableType::parameter,"k"));
+      dynamic_cast<VariableBase&>(*k).init("2");
+      auto intOp=model->addItem(OperationPtr(OperationBase::integrate));
+      dynamic_cast<IntOp&>(*intOp).description("x");
+      model->addWire(*k,*intOp,1,vector<float>());
+      reset();
+
+      logVarList.insert(":x");
+      logVarList.insert(":k");
+      openLogFile("logVariables.mlog");
+      for (int i=0; i<5; ++i)
+        step();
+      closeLogFile();
+
+      ifstream log("logVariables.mlog", ios::binary);
+      stringstream csv;
+      logToCSV(log, csv);
+      string line;
+      getline(csv, line);
+      CHECK_EQUAL("time,k,x", line);
+      for (int i=0; i<5; ++i)
+        {
+          double time, k, x;
+          char c1, c2;
+          CHECK(csv>>time>>c1>>k>>c2>>x);
+          CHECK_EQUAL(2, k);
+          CHECK_CLOSE(2*time, x, 1e-5);
+        }
+      CHECK(!(csv>>line));
+
+      // other extensions are converted to CSV on closing
+      openLogFile("logVariables.csv");
+      for (int i=0; i<5; ++i)
+        step();
+      closeLogFile();
+      ifstream csvLog("logVariables.csv");
+      getline(csvLog, line);
+      CHECK_EQUAL("time,k,x", line);
+      int rows=0;
+      while (getline(csvLog, line)) ++rows;
+      CHECK_EQUAL(5, rows);
+    }
+
+  TEST_FIXTURE(TestFixture,parameterSweep)
+    {
+      auto k=model->addItem(VariablePtr(VariableType::parameter,"k"));
+      auto u=model->addItem(VariablePtr(VariableType::parameter,"u"));
+      auto intOp=model->addItem(OperationPtr(OperationBase::integrate));
+      dynamic_cast<IntOp&>(*intOp).description("x");
+      model->addWire(*k,*intOp,1,vector<float>());
+      save("parameterSweep.mky");
+
+      ParameterSweep sweep;
+      sweep.parameters.emplace_back(":k",SweepParameter::range,0,2,3);
+      sweep.parameters.emplace_back(":u",SweepParameter::normal,0,1);
+      sweep.outputs.push_back(":x");
+      sweep.samples=2;
+      sweep.steps=1;
+      sweep.nThreads=3;
+      sweep.run("parameterSweep.mky");
+
+      CHECK_EQUAL(6, sweep.results.size());
+      for (size_t i=0; i<sweep.results.size(); ++i)
+        {
+          auto& r=sweep.results[i];
+          CHECK(r.error.empty());
+          CHECK_EQUAL(double(i/2), r.parameters[0]);
+          CHECK_CLOSE(r.parameters[0]*r.t, r.outputs[0], 1e-5);
+        }
+
+      // results do not depend on how runs are scheduled
+      auto results=sweep.results;
+      sweep.nThreads=1;
+      sweep.run("parameterSweep.mky");
+      for (size_t i=0; i<sweep.results.size(); ++i)
+        {
+          CHECK_EQUAL(results[i].parameters[1], sweep.results[i].parameters[1]);
+          CHECK_EQUAL(results[i].outputs[0], sweep.results[i].outputs[0]);
+        }
+    }
+
   /*
     check that cyclic networks throw an exception
 
@@ -697,6 +936,126 @@ SUITE(Minsky)
     EvalOp<OperationType::frac> frac;
     CHECK_CLOSE(0.2,frac.evaluate(3.2,0),1e-6);
   }
+
+  // check compiled programs agree with the EvalOps they are compiled from
+  TEST(evalProgram)
+  {
+    EvalOpBase::t=0.7;
+    for (int op=0; op<OperationType::numOps; ++op)
+      switch (op)
+        {
+        case OperationType::constant: // deprecated
+        case OperationType::integrate: case OperationType::differentiate:
+        case OperationType::data:
+          continue;
+        default:
+          {
+            EvalOpVector ev;
+            ev.push_back(EvalOpPtr(OperationType::Type(op)));
+            auto& e=*ev.back();
+            // vector op, with first argument a flow vector, and second a
+            // stock scalar
+            e.in1={1,2,3};
+            e.in2={0,0,0};
+            e.flow2=false;
+            e.out=4;
+            double fv1[]={0,0.3,0.4,0.5,0,0,0}, fv2[7], sv[]={0.6};
+            memcpy(fv2,fv1,sizeof(fv1));
+            e.eval(fv1,sv);
+            EvalProgram prog;
+            prog.compile(ev);
+            // contiguous vector elements should be coalesced
+            CHECK_EQUAL(1, prog.size());
+            prog.eval(fv2,sv);
+            for (int i=0; i<7; ++i)
+              CHECK_EQUAL(fv1[i],fv2[i]);
+          }
+        }
+  }
+  
+  // check compiled programs agree with the EvalOps they are compiled
+  // from on vectors long enough to exercise the SIMD kernels as well
+  // as their scalar tails
+  TEST(evalProgramLongVectors)
+  {
+    EvalOpBase::t=0.7;
+    const unsigned n=2*kernels::width+3;
+    // inputs at [1,n], [n+1,2n], outputs from 2n+1
+    vector<double> fv0(3*n+1), sv{0.6};
+    for (size_t i=0; i<fv0.size(); ++i)
+      fv0[i]=0.1+0.8*(i%7)/7.0;
+
+    // evaluates ev both directly and compiled, checking the results
+    // agree and the program has \a size instructions
+    auto check=[&](const EvalOpVector& ev, size_t size)
+    {
+      auto fv1=fv0, fv2=fv0;
+      EvalProgram prog;
+      prog.compile(ev);
+      CHECK_EQUAL(size, prog.size());
+      try
+        {
+          for (auto& e: ev) e->eval(fv1.data(),sv.data());
+        }
+      catch (const std::exception&)
+        {
+          CHECK_THROW(prog.eval(fv2.data(),sv.data()), std::exception);
+          return;
+        }
+      prog.eval(fv2.data(),sv.data());
+      for (size_t i=0; i<fv1.size(); ++i)
+        CHECK_EQUAL(fv1[i],fv2[i]);
+    };
+    
+    for (int op=0; op<OperationType::numOps; ++op)
+      switch (op)
+        {
+        case OperationType::constant: // deprecated
+        case OperationType::integrate: case OperationType::differentiate:
+        case OperationType::data:
+          continue;
+        default:
+          {
+            EvalOpVector ev;
+            ev.push_back(EvalOpPtr(OperationType::Type(op)));
+            auto& e=*ev.back();
+            e.out=2*n+1;
+            e.in1.resize(n);
+            e.in2.resize(n);
+
+            // contiguous flow vectors
+            for (unsigned i=0; i<n; ++i)
+              {
+                e.in1[i]=1+i;
+                e.in2[i]=n+1+i;
+              }
+            check(ev, 1);
+
+            // broadcast scalar operands
+            for (unsigned i=0; i<n; ++i)
+              e.in2[i]=0;
+            check(ev, 1);
+            e.flow2=false;
+            check(ev, 1);
+            e.flow2=true;
+            for (unsigned i=0; i<n; ++i)
+              {
+                e.in1[i]=n;
+                e.in2[i]=n+1+i;
+              }
+            check(ev, 1);
+
+            // in place, reading each element's predecessor, must be
+            // evaluated element by element
+            for (unsigned i=0; i<n; ++i)
+              {
+                e.in1[i]=e.out-1+i;
+                e.in2[i]=n+1+i;
+              }
+            check(ev, e.numArgs()? n: 1);
+          }
+        }
+  }
   
   TEST_FIXTURE(TestFixture,multiGodleyRules)
     {
@@ -1031,4 +1390,176 @@ SUITE(Minsky)
       CHECK_EQUAL(":c",c->name());
 
    }
+
+  TEST_FIXTURE(TestFixture,binarySaveLoad)
+    {
+      auto varA = model->addItem(VariablePtr(VariableType::flow, "a"));
+      auto varB = model->addItem(VariablePtr(VariableType::flow, "b"));
+      variableValues[":a"].init="0.1";
+      auto op=model->addItem(OperationBase::create(OperationType::exp));
+      model->addWire(new Wire(varA->ports[0], op->ports[1]));
+      model->addWire(new Wire(op->ports[0], varB->ports[1]));
+      varA->moveTo(10,100);
+      op->moveTo(50,100);
+      varB->moveTo(100,100);
+
+      save("binarySaveLoad.mky");
+      saveBinary("binarySaveLoad.mkyb");
+      saveBinary("binarySaveLoadUncompressed.mkyb", false);
+
+      // reloading each, and saving as XML, should give the same result
+      auto reload=[&](const char* file) {
+        load(file);
+        save("binarySaveLoadOut.mky");
+        ifstream f("binarySaveLoadOut.mky");
+        std::stringstream s;
+        s<<f.rdbuf();
+        return s.str();
+      };
+      auto xml=reload("binarySaveLoad.mky");
+      CHECK_EQUAL(xml, reload("binarySaveLoad.mkyb"));
+      CHECK_EQUAL(xml, reload("binarySaveLoadUncompressed.mkyb"));
+      CHECK_EQUAL(3, model->numItems());
+    }
+
+  TEST_FIXTURE(TestFixture,binaryLoadCorruptSizes)
+    {
+      model->addItem(VariablePtr(VariableType::flow, "a"));
+      // overwrite the packed size (offset 24) or payload size (offset
+      // 32) in the header, which must be rejected before allocation
+      auto corrupt=[&](bool compressed, long offset) {
+        saveBinary("binaryLoadCorrupt.mkyb", compressed);
+        fstream f("binaryLoadCorrupt.mkyb", ios::in|ios::out|ios::binary);
+        f.seekp(offset);
+        uint64_t huge=uint64_t(1)<<60;
+        f.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+      };
+      corrupt(true, 32);
+      CHECK_THROW(load("binaryLoadCorrupt.mkyb"), std::exception);
+      corrupt(true, 24);
+      CHECK_THROW(load("binaryLoadCorrupt.mkyb"), std::exception);
+      corrupt(false, 24);
+      CHECK_THROW(load("binaryLoadCorrupt.mkyb"), std::exception);
+    }
+
+  TEST_FIXTURE(TestFixture,pushHistoryUnchanged)
+    {
+      auto varA = model->addItem(VariablePtr(VariableType::flow, "a"));
+      auto op=model->addItem(OperationBase::create(OperationType::exp));
+      model->addWire(new Wire(varA->ports[0], op->ports[1]));
+      auto gi=new GodleyIcon;
+      model->addItem(gi);
+      gi->table.resize(3,3);
+      gi->table.cell(0,1)="c";
+      gi->table.cell(2,1)="a";
+      gi->update();
+      varA->moveTo(10,100);
+      op->moveTo(50,100);
+
+      CHECK(pushHistory());
+      // serialising an unchanged model must not add an undo step
+      CHECK(!pushHistory());
+      // nor after a command that doesn't change the model
+      canvas.setItemFocus(op);
+      canvas.select(LassoBox(0,0,200,200));
+      CHECK(!pushHistory());
+      // nor after zooming in and out again, which may leave rounding
+      // differences below the saved precision
+      model->zoom(3,7,1.1);
+      model->zoom(3,7,1/1.1);
+      varA->moveTo(10.000001,100);
+      CHECK(!pushHistory());
+      // nor after reloading the same model
+      save("pushHistoryUnchanged.mky");
+      load("pushHistoryUnchanged.mky");
+      CHECK(!pushHistory());
+
+      // but a change does
+      op->moveTo(60,100);
+      CHECK(pushHistory());
+    }
+
+  TEST_FIXTURE(TestFixture,renderCacheKeptWhenUnchanged)
+    {
+      auto time=model->addItem(OperationPtr(OperationType::time));
+      auto a=model->addItem(VariablePtr(VariableType::flow,"a"));
+      auto p=model->addItem(VariablePtr(VariableType::parameter,"p"));
+      dynamic_cast<VariableBase&>(*p).init("3");
+      model->addWire(*time,*a,1,vector<float>());
+      time->moveTo(100,100);
+      a->moveTo(200,100);
+      p->moveTo(300,100);
+      canvas.surface.reset(new ecolab::cairo::Surface
+                           (cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA,nullptr)));
+      reset();
+      pushHistory();
+      step();
+      canvas.redraw();
+      auto recording=p->renderCache.recording.get();
+      CHECK(recording);
+
+      // only items whose displayed value changed are rerendered after a step
+      step();
+      CHECK(!p->renderCache.dirty);
+      CHECK(a->renderCache.dirty);
+      canvas.redraw();
+      CHECK(recording==p->renderCache.recording.get());
+
+      // neither an unchanged model nor a full redraw discards renderings
+      CHECK(!pushHistory());
+      canvas.redraw();
+      CHECK(recording==p->renderCache.recording.get());
+
+      // but a change to the model does
+      time->moveTo(120,100);
+      CHECK(pushHistory());
+      canvas.redraw();
+      CHECK(recording!=p->renderCache.recording.get());
+    }
+
+  TEST_FIXTURE(TestFixture,streamLoad)
+    {
+      auto gi=new GodleyIcon;
+      model->addItem(gi);
+      gi->table.resize(3,3);
+      gi->table.cell(0,1)="c";
+      gi->table.cell(0,2)="d";
+      gi->table.cell(2,1)="a";
+      gi->table.cell(2,2)="b";
+      gi->update();
+      auto intOp=model->addItem(OperationBase::create(OperationType::integrate));
+      auto mulOp=model->addItem(OperationBase::create(OperationType::multiply));
+      mulOp->detailedText="<a & b>";
+      model->addWire(*intOp, *mulOp, 1, {});
+      auto group=model->addGroup(new Group);
+      group->addItem(mulOp);
+      model->setZoom(2);
+      nSteps=7;
+      save("streamLoad.mky");
+
+      // should construct the same model as unpacking the whole document
+      auto canonical=[](Minsky& m) {
+        LocalMinsky lm(m);
+        ostringstream os;
+        xml_pack_t x(os);
+        schema2::Minsky schema(m);
+        xml_pack(x,"Minsky",schema);
+        return os.str();
+      };
+      schema2::Minsky schema;
+      {
+        ifstream f("streamLoad.mky");
+        xml_unpack_t x(f);
+        xml_unpack(x,"Minsky",schema);
+      }
+      Minsky full=schema, streamed;
+      ifstream f("streamLoad.mky");
+      vector<double> progress;
+      CHECK(schema2::Minsky::streamLoad(f, streamed, [&](double x){progress.push_back(x);}));
+      CHECK_EQUAL(canonical(full), canonical(streamed));
+      CHECK_EQUAL(7, streamed.nSteps);
+      CHECK(!progress.empty());
+      CHECK(std::is_sorted(progress.begin(), progress.end()));
+      CHECK_EQUAL(1, progress.back());
+    }
 }
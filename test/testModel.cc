@@ -341,6 +341,59 @@ SUITE(Canvas)
       CHECK(canvas.wire==ab);
     }
   
+  TEST_FIXTURE(TestFixture, itemAtAfterMove)
+    {
+      float x=c->x(), y=c->y();
+      canvas.getItemAt(x,y);
+      CHECK(c==canvas.item);
+      c->moveTo(x+500,y+500);
+      canvas.getItemAt(x,y);
+      CHECK(!canvas.item);
+      canvas.getItemAt(x+500,y+500);
+      CHECK(c==canvas.item);
+      model->removeItem(*c);
+      canvas.getItemAt(x+500,y+500);
+      CHECK(!canvas.item);
+    }
+
+  TEST_FIXTURE(TestFixture, itemAtAfterGroupChanges)
+    {
+      canvas.item=group0;
+      canvas.zoomToDisplay();
+      canvas.getItemAt(a->x()+2,a->y()+2);
+      CHECK(a==canvas.item);
+
+      // moving a group moves its contents and their wires
+      float ax=a->x(), ay=a->y();
+      group0->moveTo(group0->x()+400,group0->y()+400);
+      canvas.getItemAt(ax+2,ay+2);
+      CHECK(a!=canvas.item);
+      canvas.getItemAt(a->x()+2,a->y()+2);
+      CHECK(a==canvas.item);
+      auto from=a->ports[0], to=b->ports[1];
+      canvas.getWireAt(0.5f*(from->x()+to->x())+1, 0.5f*(from->y()+to->y())+1);
+      CHECK(canvas.wire==ab);
+
+      // items added since the index was built are found
+      auto d=model->addItem(VariablePtr(VariableType::flow,"d"));
+      d->moveTo(1000,1000);
+      canvas.getItemAt(1000,1000);
+      CHECK(d==canvas.item);
+
+      // removing a group removes its contents
+      model->removeGroup(*group0);
+      canvas.getItemAt(a->x()+2,a->y()+2);
+      CHECK(a!=canvas.item);
+    }
+
+  TEST_FIXTURE(TestFixture, mouseFocus)
+    {
+      canvas.mouseMove(c->x(),c->y());
+      CHECK(c->mouseFocus);
+      canvas.mouseMove(c->x()+500,c->y()+500);
+      CHECK(!c->mouseFocus);
+    }
+  
   TEST_FIXTURE(Canvas,findVariableDefinition)
     {
       model=cminsky().model;
@@ -609,6 +662,56 @@ SUITE(Canvas)
         
       }
 
+    TEST_FIXTURE(Canvas, renderCache)
+      {
+        model.reset(new Group);
+        model->self=model;
+        surface.reset(new cairo::Surface(cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA,nullptr)));
+        OperationPtr a(OperationType::exp);
+        model->addItem(a);
+        a->moveTo(100,100);
+        VariablePtr v(VariableType::flow,"v");
+        model->addItem(v);
+        v->moveTo(300,300);
+
+        redraw(0,0,1000,1000);
+        auto recording=a->renderCache.recording.get();
+        CHECK(recording);
+        CHECK(!a->renderCache.dirty);
+        CHECK(!v->renderCache.dirty);
+
+        // unchanged items are replayed from their recordings
+        redraw(0,0,1000,1000);
+        CHECK(recording==a->renderCache.recording.get());
+        // including on full redraws
+        redraw();
+        CHECK(recording==a->renderCache.recording.get());
+
+        // moving an item rerenders it
+        a->moveTo(150,150);
+        redraw(0,0,1000,1000);
+        CHECK(recording!=a->renderCache.recording.get());
+
+        // items outside the update region are not drawn
+        recording=a->renderCache.recording.get();
+        v->renderCache.dirty=true;
+        a->renderCache.dirty=true;
+        redraw(140,140,20,20);
+        CHECK(v->renderCache.dirty);
+        CHECK(!a->renderCache.dirty);
+        CHECK(recording!=a->renderCache.recording.get());
+
+        // as does changing displayed state, such as a tooltip or slider
+        recording=a->renderCache.recording.get();
+        a->tooltip="exponential";
+        redraw(0,0,1000,1000);
+        CHECK(recording!=a->renderCache.recording.get());
+        auto vrecording=v->renderCache.recording.get();
+        v->sliderVisible(true);
+        redraw(0,0,1000,1000);
+        CHECK(vrecording!=v->renderCache.recording.get());
+      }
+
     TEST_FIXTURE(Canvas, removeItemFromItsGroup)
       {
         model.reset(new Group);
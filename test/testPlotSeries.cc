@@ -0,0 +1,136 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "plotSeries.h"
+#include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <math.h>
+using namespace minsky;
+using namespace std;
+
+SUITE(PlotSeries)
+{
+  TEST(smallSeriesNotDecimated)
+    {
+      PlotSeries s;
+      for (int i=0; i<10; ++i)
+        s.append(i, i*i);
+      vector<double> x, y;
+      s.decimate(10, x, y);
+      CHECK_EQUAL(10, x.size());
+      CHECK_ARRAY_EQUAL(&x[0], vector<double>({0,1,2,3,4,5,6,7,8,9}), 10);
+    }
+
+  TEST(decimationPreservesExtrema)
+    {
+      PlotSeries s;
+      vector<double> ys;
+      for (int i=0; i<100000; ++i)
+        {
+          ys.push_back(sin(0.001*i)+0.01*(i%7));
+          s.append(0.5*i, ys.back());
+        }
+      vector<double> x, y;
+      s.decimate(100, x, y);
+      CHECK(x.size()<=400);
+      CHECK_EQUAL(0, x.front());
+      CHECK_EQUAL(0.5*99999, x.back());
+      CHECK_EQUAL(*min_element(ys.begin(), ys.end()), *min_element(y.begin(), y.end()));
+      CHECK_EQUAL(*max_element(ys.begin(), ys.end()), *max_element(y.begin(), y.end()));
+      CHECK(is_sorted(x.begin(), x.end()));
+
+      // each output point is a sample of the series
+      for (size_t i=0; i<x.size(); ++i)
+        CHECK_EQUAL(ys[size_t(2*x[i])], y[i]);
+    }
+
+  TEST(nonMonotonicNotDecimated)
+    {
+      PlotSeries s;
+      for (int i=0; i<1000; ++i)
+        s.append(sin(i), i);
+      CHECK(!s.monotonic());
+      vector<double> x, y;
+      s.decimate(10, x, y);
+      CHECK_EQUAL(1000, x.size());
+    }
+
+  TEST(retainSamples)
+    {
+      PlotSeries s;
+      s.retain(100,0);
+      for (int i=0; i<1000; ++i)
+        s.append(i, i%37);
+      CHECK_EQUAL(1000, s.end());
+      CHECK_EQUAL(900, s.first());
+      CHECK_EQUAL(100, s.size());
+      CHECK_EQUAL(900, s.x(900));
+      CHECK_EQUAL(999%37, s.y(999));
+      vector<double> x, y;
+      s.decimate(10, x, y);
+      CHECK_EQUAL(900, x.front());
+      CHECK_EQUAL(999, x.back());
+      CHECK_EQUAL(0, *min_element(y.begin(), y.end()));
+      CHECK_EQUAL(36, *max_element(y.begin(), y.end()));
+
+      // tightening the policy discards older samples
+      s.retain(10,0);
+      CHECK_EQUAL(990, s.first());
+    }
+
+  TEST(retainTime)
+    {
+      PlotSeries s;
+      s.retain(0,50);
+      for (int i=0; i<1000; ++i)
+        s.append(0.5*i, i);
+      CHECK_EQUAL(0.5*999-50, s.x(s.first()));
+      CHECK_EQUAL(101, s.size());
+    }
+
+  TEST(spillToDisk)
+    {
+      PlotSeries s;
+      s.retain(100,0);
+      s.spillTo("testPlotSeries.spill");
+      for (int i=0; i<100000; ++i)
+        s.append(i, sin(0.001*i));
+      CHECK_EQUAL(99900, s.firstRetained());
+      CHECK_EQUAL(0, s.first());
+      for (size_t i=0; i<s.end(); i+=997)
+        CHECK_EQUAL(sin(0.001*i), s.y(i));
+
+      // scroll back into the spilled history
+      vector<double> x, y;
+      s.decimate(100, x, y, 1000, 5000);
+      CHECK(x.size()<=400);
+      CHECK_EQUAL(1000, x.front());
+      CHECK_EQUAL(5000, x.back());
+      CHECK_CLOSE(1, *max_element(y.begin(), y.end()), 1e-6);
+
+      // a copy holds only the retained data
+      PlotSeries c(s);
+      CHECK_EQUAL(99900, c.first());
+      CHECK_EQUAL(s.y(99950), c.y(99950));
+
+      s.clear();
+      CHECK(s.empty());
+      CHECK_EQUAL(0, s.size());
+    }
+}
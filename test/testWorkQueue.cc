@@ -0,0 +1,173 @@
+/*
+  @copyright Steve Keen 2018
+  @author Russell Standish
+  This file is part of Minsky.
+
+  Minsky is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Minsky is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Minsky.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/workQueue.h"
+#include <ecolab_epilogue.h>
+#include <UnitTest++/UnitTest++.h>
+#include <thread>
+#include <vector>
+
+using namespace minsky;
+using namespace minsky::websocket;
+using namespace std;
+
+SUITE(WorkQueue)
+{
+  TEST(fullAndEmpty)
+    {
+      MPMCQueue<int> q(3);
+      CHECK_EQUAL(4, q.capacity());
+      int x=-1;
+      CHECK(!q.pop(x));
+      CHECK_EQUAL(-1, x);
+
+      // wrap around the ring a few times
+      for (int round=0; round<3; ++round)
+        {
+          for (int i=0; i<4; ++i)
+            CHECK(q.push(10*round+i));
+          CHECK_EQUAL(4, q.size());
+          CHECK(!q.push(99));
+          for (int i=0; i<4; ++i)
+            {
+              CHECK(q.pop(x));
+              CHECK_EQUAL(10*round+i, x);
+            }
+          CHECK(!q.pop(x));
+          CHECK_EQUAL(0, q.size());
+        }
+    }
+
+  TEST(multiProducerMultiConsumer)
+    {
+      // a small queue, so producers regularly find it full
+      MPMCQueue<int> q(64);
+      const int numProducers=4, numConsumers=4, perProducer=20000;
+      const int total=numProducers*perProducer;
+      vector<atomic<int>> seen(total);
+      for (auto& i: seen) i=0;
+      atomic<int> consumed{0};
+
+      vector<thread> threads;
+      for (int p=0; p<numProducers; ++p)
+        threads.emplace_back([&,p]() {
+            for (int i=0; i<perProducer; ++i)
+              while (!q.push(p*perProducer+i))
+                this_thread::yield();
+          });
+      for (int c=0; c<numConsumers; ++c)
+        threads.emplace_back([&]() {
+            int x;
+            while (consumed<total)
+              if (q.pop(x))
+                {
+                  if (x>=0 && x<total)
+                    seen[x]++;
+                  consumed++;
+                }
+              else
+                this_thread::yield();
+          });
+      for (auto& t: threads) t.join();
+
+      // each value received exactly once
+      CHECK_EQUAL(total, consumed);
+      int missing=0, duplicated=0;
+      for (auto& i: seen)
+        {
+          if (i==0) ++missing;
+          if (i>1) ++duplicated;
+        }
+      CHECK_EQUAL(0, missing);
+      CHECK_EQUAL(0, duplicated);
+      int x;
+      CHECK(!q.pop(x));
+    }
+
+  TEST(pushWakesBlockedWorker)
+    {
+      Workers<int> w(16);
+      int x=0;
+      bool got=false;
+      thread worker([&]() {got=w.pop(x);});
+      // give the worker time to block
+      this_thread::sleep_for(chrono::milliseconds(50));
+      CHECK(w.push(42));
+      worker.join();
+      CHECK(got);
+      CHECK_EQUAL(42, x);
+    }
+
+  TEST(stopWakesBlockedWorkers)
+    {
+      Workers<int> w(16);
+      atomic<int> returned{0}, succeeded{0};
+      vector<thread> workers;
+      for (int i=0; i<3; ++i)
+        workers.emplace_back([&]() {
+            int x;
+            if (w.pop(x)) succeeded++;
+            returned++;
+          });
+      this_thread::sleep_for(chrono::milliseconds(50));
+      CHECK_EQUAL(0, returned);
+      w.stop();
+      for (auto& t: workers) t.join();
+      CHECK_EQUAL(3, returned);
+      CHECK_EQUAL(0, succeeded);
+      // and once stopped, pop returns immediately
+      int x;
+      CHECK(!w.pop(x));
+    }
+
+  TEST(latencyPercentiles)
+    {
+      LatencyHistogram h;
+      auto s=h.stats();
+      CHECK_EQUAL(0, s.requests);
+      CHECK_EQUAL(0, s.p50);
+      CHECK_EQUAL(0, s.max);
+
+      // latencies of 1..1000µs
+      for (int i=1; i<=1000; ++i)
+        h.record(chrono::microseconds(i));
+      s=h.stats();
+      CHECK_EQUAL(1000, s.requests);
+      CHECK_EQUAL(1000, s.max);
+      // percentiles are reported as the upper bound of the bucket
+      // holding them, so lie within a bucket width (2^¼) above
+      const double width=exp2(0.25);
+      struct {double value, expected;} percentiles[]=
+        {{s.p50,500},{s.p90,900},{s.p99,990},{s.p999,999}};
+      for (auto& p: percentiles)
+        {
+          CHECK(p.value>=p.expected);
+          CHECK(p.value<=p.expected*width);
+        }
+      // nor exceed the maximum recorded
+      CHECK(s.p999<=s.max);
+
+      // sub-microsecond latencies fall in the first bucket
+      LatencyHistogram fast;
+      fast.record(chrono::nanoseconds(100));
+      s=fast.stats();
+      CHECK_EQUAL(1, s.requests);
+      CHECK_EQUAL(0, s.p50);
+    }
+}